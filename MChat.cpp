@@ -9,8 +9,46 @@ extern bool DEBUG;
 
 using namespace std;
 
-int main () {
+/**
+ * Compiles a sample text or dictionary file into a compiled model file.
+ * usage: MChat --compile <TRUE|FALSE> <input file> <output file> [order [memory]]
+ *   TRUE if the input file is a dictionary file, FALSE if it is a sample text file.
+ *   order is the order of the markov chain, 1 by default.
+ *   memory is the memory for counting transitions in megabytes, 0 (unlimited) by default. see global learn_memory.
+ */
+int compile_model(int argc, char *argv[]){
+  Language_Options options;
+  if(argc >= 6) options.order = atoi(argv[5]);
+  if(argc >= 7) options.memory_budget = (size_t) max(atoi(argv[6]), 0) * 1024 * 1024;
+  if(argc < 5 || 7 < argc || !(string(argv[2]) == "TRUE" || string(argv[2]) == "FALSE") || options.order < 1 || MAX_ORDER < options.order){
+    cerr << "usage: " << argv[0] << " --compile <TRUE|FALSE> <input file> <output file> [order [memory]]" << endl;
+    return 1;
+  }
+  Language language(options);
+  language.learn_file(argv[3], string(argv[2]) == "TRUE");
+  return language.save_model(argv[4]) ? 0 : 1;
+}
+
+/**
+ * Runs config.txt over simulated days without sending anything and reports the cost.
+ * usage: MChat --dry-run <days>
+ */
+int dry_run(int argc, char *argv[]){
+  int days = argc == 3 ? atoi(argv[2]) : 0;
+  if(days <= 0){
+    cerr << "usage: " << argv[0] << " --dry-run <days>" << endl;
+    return 1;
+  }
+  DEBUG = false; // logging every message would be most of the cost.
+  MChat_Base master = MChat_Base();
+  master.dry_run(days);
+  return 0;
+}
+
+int main (int argc, char *argv[]) {
   DEBUG = true;
+  if(argc > 1 && string(argv[1]) == "--compile") return compile_model(argc, argv);
+  if(argc > 1 && string(argv[1]) == "--dry-run") return dry_run(argc, argv);
   MChat_Base master = MChat_Base();
   master.start();
 }
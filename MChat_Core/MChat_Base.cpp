@@ -1,32 +1,182 @@
 #include "My_Library\LOG.hpp"
 #include "My_Library\Message_Handler.cpp"
 #include "My_Library\Message_Sender.cpp"
+#include "My_Library\Thread_Pool.cpp"
+#include "My_Library\Send_Worker.cpp"
+#include "My_Library\File_Watcher.cpp"
 #include "Parser.cpp"
 
+#include <iostream>
 #include <list>
+#include <queue>
+#include <vector>
+#include <chrono>
+#include <memory>
 #include <windows.h>
 
-extern int UPDATE_INTERVAL;
+extern int UPDATE_THREADS;
+extern int INPUT_DELAY;
+extern int SEND_BUDGET;
+extern int RELOAD_INTERVAL;
 
+/**
+ * Runs the config. Sleeps until the earliest handler deadline instead of polling.
+ * The messages are typed by a Send_Worker. Senders that could not find their window try again after UPDATE_INTERVAL.
+ * With a SEND_BUDGET the messages are typed on the main loop instead, a few keystrokes per sender at a time.
+ * Handlers that are due at the same time are updated on UPDATE_THREADS threads.
+ * config.txt is checked every RELOAD_INTERVAL and reloaded between two ticks when it changed.
+ */
 class MChat_Base {
 private:
   list<Message_Handler*> m_MH_list;
   list<Message_Sender*> m_MS_list;
+  unique_ptr<Main_Parser> m_parser; // the parser of the config that runs. it knows the senders for the next reload.
 public:
   void start(){
     ifstream ss("config.txt");
-    Main_Parser main = Main_Parser();
-    main.parse(ss, m_MH_list, m_MS_list);
+    m_parser.reset(new Main_Parser());
+    if(!(*m_parser).parse(ss, m_MH_list, m_MS_list)){
+      LOG("MChat_Base " << this << " >> start(): config.txt has an error. Exiting program...");
+      exit(1);
+    }
 
-    Timer timer_clock = Timer(UPDATE_INTERVAL);
+    File_Watcher config("config.txt");
+    Timer timer_clock;
     while(true){
-      for(auto itr = m_MH_list.begin(); itr != m_MH_list.end(); itr++){
-        (**itr).update(timer_clock.get_tm());
+      if(SEND_BUDGET > 0){
+        run(timer_clock, NO_DEADLINE, NULL, &config);
+      }else{
+        Send_Worker worker(m_MS_list);
+        run(timer_clock, NO_DEADLINE, &worker, &config);
+      } // the worker finished its last round, so nothing sends anymore.
+      reload();
+    }
+  }
+
+  /**
+   * Runs the config over simulated days as fast as possible, with senders that drop every message,
+   * and reports what every handler did and what it cost.
+   * int days: the number of days to simulate, starting now.
+   */
+  void dry_run(int days){
+    ifstream ss("config.txt");
+    Main_Parser main = Main_Parser(true);
+    if(!main.parse(ss, m_MH_list, m_MS_list)){
+      cerr << "config.txt has an error." << endl;
+      exit(1);
+    }
+
+    Virtual_Clock clock(System_Clock().now());
+    Timer timer_clock(&clock);
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    long long wakeups = run(timer_clock, timer_clock.now() + days * 86400000LL, NULL, NULL);
+    long long total_time = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count();
+
+    long long queue_time = 0;
+    cout << "Dry run of " << days << " days: " << wakeups << " wakeups in " << total_time / 1000000.0 << " ms." << endl;
+    for(auto itr = m_MH_list.begin(); itr != m_MH_list.end(); itr++){
+      int count = (**itr).get_message_count();
+      cout << "  " << (**itr).get_name() << ": " << count << " messages, " << (**itr).get_skipped_count() << " skipped, "
+           << (count > 0 ? (**itr).get_queue_time() / 1000.0 / count : 0.0) << " us per message." << endl;
+      queue_time += (**itr).get_queue_time();
+    }
+    cout << "Loop overhead: " << (total_time - queue_time) / 1000.0 / max(wakeups, 1LL) << " us per wakeup." << endl;
+  }
+
+private:
+  /**
+   * Parses config.txt again and swaps the new handlers and senders in. Nothing may send while it runs.
+   * Senders that are made with the same settings are kept with their queues, the languages that are still used
+   * are shared by the new handlers instead of learned again, and schedules are interned anyway.
+   * If the file has an error, the config that runs is kept as it is.
+   */
+  void reload(){
+    LOG("MChat_Base " << this << " >> reload(): reloading config.txt");
+    ifstream ss("config.txt");
+    unique_ptr<Main_Parser> parser(new Main_Parser());
+    (*parser).reuse(*m_parser);
+    list<Message_Handler*> MH_list;
+    list<Message_Sender*> MS_list;
+    if(!(*parser).parse(ss, MH_list, MS_list)){
+      LOG("MChat_Base " << this << " >> reload(): config.txt has an error. keeping the config that runs.");
+      return;
+    }
+
+    // the old handlers go after the parse, so the languages they hold are still in the Language_Registry for the new ones.
+    for(auto itr = m_MH_list.begin(); itr != m_MH_list.end(); itr++){
+      delete *itr;
+    }
+    list<Message_Sender*> unused;
+    (*parser).get_unused(unused);
+    for(auto itr = unused.begin(); itr != unused.end(); itr++){
+      delete *itr;
+    }
+    m_MH_list.swap(MH_list);
+    m_MS_list.swap(MS_list);
+    m_parser.swap(parser);
+    LOG("MChat_Base " << this << " >> reload(): " << m_MH_list.size() << " handlers, " << m_MS_list.size() << " senders, " << unused.size() << " senders dropped.");
+  }
+
+  /**
+   * Updates every handler when it is due and sends what they queued, until a time or until the config changed.
+   * Timer &timer_clock: the source of the time.
+   * long long end: the time to stop at. NO_DEADLINE to run forever.
+   * Send_Worker *worker: sends the messages in the background. NULL to send them on this thread, SEND_BUDGET keystrokes at a time.
+   * File_Watcher *config: stops the loop when the config changed. NULL to never stop for it.
+   * long long return: the number of times the loop woke up.
+   */
+  long long run(Timer &timer_clock, long long end, Send_Worker *worker, File_Watcher *config){
+    Send_Planner planner(m_MS_list); // sends on this thread if there is no worker.
+    vector<Send_Report> reports;
+    // min-heap of when each handler has to be updated next.
+    priority_queue<pair<long long, Message_Handler*>, vector<pair<long long, Message_Handler*>>, greater<pair<long long, Message_Handler*>>> deadlines;
+    long long now = timer_clock.now();
+    for(auto itr = m_MH_list.begin(); itr != m_MH_list.end(); itr++){
+      deadlines.push(make_pair(now, *itr));
+    }
+    long long retry = NO_DEADLINE; // when to call the senders again: to retry the ones that failed, or after a rate limit or the budget.
+    long long wakeups = 0;
+    Thread_Pool pool(UPDATE_THREADS);
+    vector<Message_Handler*> due; // the handlers to update in this tick.
+    vector<long long> next_deadlines; // what every due handler returned.
+    bool watch = config != NULL && RELOAD_INTERVAL > 0;
+    long long next_check = watch ? now + RELOAD_INTERVAL : NO_DEADLINE; // when to check the config next.
+
+    while((now = timer_clock.now()) < end){
+      wakeups++;
+      due.clear();
+      while(!deadlines.empty() && deadlines.top().first <= now){
+        due.push_back(deadlines.top().second);
+        deadlines.pop();
+      }
+      // every handler is updated by one thread, so its RNG is only used by one thread at a time and in the same order.
+      next_deadlines.resize(due.size());
+      pool.run(due.size(), [&](size_t i){ next_deadlines[i] = (*due[i]).update(now); });
+      for(size_t i = 0; i < due.size(); i++){
+        deadlines.push(make_pair(next_deadlines[i], due[i]));
+      }
+      if(worker != NULL){
+        if(!due.empty()) (*worker).notify(); // only hands the messages over, the typing happens on the worker.
+        Send_Report report;
+        while((*worker).poll_report(report)){
+          LOG("MChat_Base " << this << " >> run(): Message_Sender " << report.sender << (report.sent ? " sent." : " failed, retrying later."));
+        }
+      }else{
+        reports.clear();
+        long long wait = planner.send(SEND_BUDGET, reports);
+        for(Send_Report &report : reports){
+          if(!report.sent) LOG("MChat_Base " << this << " >> run(): Message_Sender " << report.sender << " failed, retrying later.");
+        }
+        // if the budget ran out, go on after the handlers had their turn.
+        retry = wait == NO_DEADLINE ? NO_DEADLINE : timer_clock.now() + max(wait, (long long) INPUT_DELAY);
       }
-      for(auto itr = m_MS_list.begin(); itr != m_MS_list.end(); itr++){
-        (**itr).send();
+      if(now >= next_check){
+        if((*config).changed()) break;
+        next_check = now + RELOAD_INTERVAL;
       }
-      timer_clock.wait_next();
+      long long next = deadlines.empty() ? retry : min(retry, deadlines.top().first);
+      timer_clock.wait_until(min(min(next, next_check), end));
     }
+    return wakeups;
   }
 };
@@ -0,0 +1,98 @@
+#include "LOG.hpp"
+
+#ifndef _H_CLIPBOARD
+#define _H_CLIPBOARD
+
+#include <string>
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+using namespace std;
+
+/**
+ * Interface for classes that put text in the clipboard, so a sender can paste a message instead of typing it.
+ */
+class Clipboard{
+public:
+  virtual ~Clipboard(){}
+
+  /**
+   * Replaces the contents of the clipboard.
+   * const string &text: the text. UTF-8.
+   * bool return: false if the clipboard could not be set.
+   */
+  virtual bool set_text(const string &text) = 0;
+};
+
+#ifdef _WIN32
+/**
+ * The Windows clipboard. The text is stored as CF_UNICODETEXT, so any character can be pasted.
+ * Whatever the user had in the clipboard is replaced.
+ */
+class Windows_Clipboard : public Clipboard{
+public:
+  bool set_text(const string &text){
+    int length = MultiByteToWideChar(CP_UTF8, 0, text.c_str(), -1, NULL, 0); // counts the terminating null.
+    if(length == 0) return false;
+    HGLOBAL memory = GlobalAlloc(GMEM_MOVEABLE, length * sizeof(WCHAR));
+    if(memory == NULL) return false;
+    WCHAR *buffer = (WCHAR*) GlobalLock(memory);
+    MultiByteToWideChar(CP_UTF8, 0, text.c_str(), -1, buffer, length);
+    GlobalUnlock(memory);
+
+    if(!OpenClipboard(NULL)){ // another program has it open.
+      LOG("Windows_Clipboard " << this << " >> set_text(): the clipboard is in use.");
+      GlobalFree(memory);
+      return false;
+    }
+    EmptyClipboard();
+    bool ret = SetClipboardData(CF_UNICODETEXT, memory) != NULL; // the clipboard owns the memory from here.
+    if(!ret) GlobalFree(memory);
+    CloseClipboard();
+    return ret;
+  }
+};
+#endif
+
+/**
+ * A Clipboard that keeps the text in a string. It can be made to fail like a clipboard that another program has open.
+ */
+class Memory_Clipboard : public Clipboard{
+  string m_text; // the contents.
+  bool m_available; // set_text() fails if false.
+  size_t m_calls; // the number of set_text() calls so far.
+
+public:
+  /**
+   * Constructor
+   */
+  Memory_Clipboard(){
+    m_available = true;
+    m_calls = 0;
+  }
+
+  bool set_text(const string &text){
+    m_calls++;
+    if(!m_available) return false;
+    m_text = text;
+    return true;
+  }
+
+  /** get the contents */
+  string get_text() const {
+    return m_text;
+  }
+
+  /** get the number of set_text() calls so far, failed ones included */
+  size_t get_calls() const {
+    return m_calls;
+  }
+
+  /** makes set_text() fail if available is false, as if another program had the clipboard open */
+  void set_available(bool available){
+    m_available = available;
+  }
+};
+
+#endif
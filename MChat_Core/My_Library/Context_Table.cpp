@@ -0,0 +1,191 @@
+#include "LOG.hpp"
+
+#ifndef _H_CONTEXT_TABLE
+#define _H_CONTEXT_TABLE
+
+#include <vector>
+#include <cstdint>
+
+#define MAX_ORDER 4 // the highest supported order of a markov chain.
+#define NO_TOKEN UINT32_MAX // fills the unused ids of a context.
+
+using namespace std;
+
+/**
+ * Interns the contexts (states) of a markov chain. A context is the last 1 to MAX_ORDER token ids,
+ * oldest first, stored as a fixed-width tuple padded with NO_TOKEN. Every distinct context gets a state id,
+ * handed out in the order the contexts are first seen, through an open-addressed hash table on the tuple.
+ * Like Token_Table, it can be attached to the arrays of a compiled model file.
+ */
+class Context_Table{
+  vector<uint32_t> m_contexts; // MAX_ORDER ids of every context. indexed by state * MAX_ORDER.
+  vector<uint32_t> m_slots; // open-addressed hash table of states. holds state + 1, 0 means the slot is empty.
+
+  // the arrays that are read. they point into the vectors above, or into an attached model file.
+  bool m_attached; // true if the arrays are attached.
+  uint32_t m_count; // the number of contexts.
+  uint32_t m_slot_count; // the size of the hash table. a power of 2.
+  const uint32_t *m_contexts_p;
+  const uint32_t *m_slots_p;
+
+public:
+  /** Constructor */
+  Context_Table(){
+    m_slots.assign(64, 0);
+    m_attached = false;
+    update_pointers();
+  }
+
+  /**
+   * Reads the contexts from somewhere else instead. The arrays must outlive this object or the next intern().
+   * uint32_t count: the number of contexts.
+   * const uint32_t *contexts: count * MAX_ORDER ids.
+   * uint32_t slot_count: the size of the hash table. a power of 2.
+   * const uint32_t *slots: the hash table, as written from get_slot().
+   */
+  void attach(uint32_t count, const uint32_t *contexts, uint32_t slot_count, const uint32_t *slots){
+    m_contexts.clear();
+    m_slots.clear();
+    m_attached = true;
+    m_count = count;
+    m_contexts_p = contexts;
+    m_slot_count = slot_count;
+    m_slots_p = slots;
+  }
+
+  /**
+   * Returns the state of a context, adding it if it is new.
+   * const uint32_t *ids: the ids of the context, oldest first.
+   * int order: the number of ids. 1 to MAX_ORDER.
+   * uint32_t return: the state of the context.
+   */
+  uint32_t intern(const uint32_t *ids, int order){
+    if(m_attached) detach();
+    uint32_t key[MAX_ORDER];
+    make_key(ids, order, key);
+    size_t slot = find_slot(key);
+    if(m_slots[slot] != 0) return m_slots[slot] - 1;
+
+    m_contexts.insert(m_contexts.end(), key, key + MAX_ORDER);
+    m_slots[slot] = size();
+    if(size() * 2 > m_slots.size()) grow();
+    update_pointers();
+    return size() - 1;
+  }
+
+  /**
+   * Looks up the state of a context without adding it.
+   * const uint32_t *ids: the ids of the context, oldest first.
+   * int order: the number of ids. 1 to MAX_ORDER.
+   * int64_t return: the state of the context. -1 if the context is unknown.
+   */
+  int64_t find(const uint32_t *ids, int order) const {
+    uint32_t key[MAX_ORDER];
+    make_key(ids, order, key);
+    size_t slot = find_slot(key);
+    if(m_slots_p[slot] == 0) return -1;
+    return m_slots_p[slot] - 1;
+  }
+
+  /** get the MAX_ORDER ids of the context of a state */
+  const uint32_t *get_context(uint32_t state) const {
+    return m_contexts_p + (size_t) state * MAX_ORDER;
+  }
+
+  /** get the number of ids in the context of a state */
+  int get_order(uint32_t state) const {
+    int order = 0;
+    while(order < MAX_ORDER && get_context(state)[order] != NO_TOKEN) order++;
+    return order;
+  }
+
+  /** get the number of distinct contexts */
+  uint32_t size() const {
+    return m_attached ? m_count : m_contexts.size() / MAX_ORDER;
+  }
+
+  /** get the size of the hash table */
+  uint32_t get_slot_count() const {
+    return m_slot_count;
+  }
+
+  /** get a slot of the hash table */
+  uint32_t get_slot(uint32_t i) const {
+    return m_slots_p[i];
+  }
+
+private:
+  /**
+   * Copies the attached arrays so new contexts can be added.
+   */
+  void detach(){
+    LOG("Context_Table " << this << " >> detach(): copying " << m_count << " contexts.");
+    m_contexts.assign(m_contexts_p, m_contexts_p + (size_t) m_count * MAX_ORDER);
+    m_slots.assign(m_slots_p, m_slots_p + m_slot_count);
+    m_attached = false;
+    update_pointers();
+  }
+
+  /** points the arrays that are read at the vectors. */
+  void update_pointers(){
+    m_count = m_contexts.size() / MAX_ORDER;
+    m_contexts_p = m_contexts.data();
+    m_slot_count = m_slots.size();
+    m_slots_p = m_slots.data();
+  }
+
+  /** pads a context to MAX_ORDER ids. */
+  static void make_key(const uint32_t *ids, int order, uint32_t *key){
+    for(int i = 0; i < MAX_ORDER; i++){
+      key[i] = i < order ? ids[i] : NO_TOKEN;
+    }
+  }
+
+  /**
+   * Finds the slot holding a context, or the empty slot the context would go into.
+   */
+  size_t find_slot(const uint32_t *key) const {
+    size_t mask = m_slot_count - 1;
+    size_t slot = hash_context(key) & mask;
+    while(m_slots_p[slot] != 0 && !equals(get_context(m_slots_p[slot] - 1), key)){
+      slot = (slot + 1) & mask;
+    }
+    return slot;
+  }
+
+  /**
+   * Doubles the hash table and re-inserts every state.
+   */
+  void grow(){
+    m_slots.assign(m_slots.size() * 2, 0);
+    size_t mask = m_slots.size() - 1;
+    for(uint32_t state = 0; state < m_contexts.size() / MAX_ORDER; state++){
+      size_t slot = hash_context(&m_contexts[(size_t) state * MAX_ORDER]) & mask;
+      while(m_slots[slot] != 0) slot = (slot + 1) & mask;
+      m_slots[slot] = state + 1;
+    }
+  }
+
+  static bool equals(const uint32_t *a, const uint32_t *b){
+    for(int i = 0; i < MAX_ORDER; i++){
+      if(a[i] != b[i]) return false;
+    }
+    return true;
+  }
+
+  /** splitmix64 finalizer over the ids, two at a time. */
+  static uint64_t hash_context(const uint32_t *key){
+    uint64_t h = 0;
+    for(int i = 0; i < MAX_ORDER; i += 2){
+      h ^= ((uint64_t) key[i] << 32) | key[i + 1];
+      h ^= h >> 30;
+      h *= 0xbf58476d1ce4e5b9ULL;
+      h ^= h >> 27;
+      h *= 0x94d049bb133111ebULL;
+      h ^= h >> 31;
+    }
+    return h;
+  }
+};
+
+#endif
@@ -0,0 +1,60 @@
+#include "LOG.hpp"
+
+#ifndef _H_FILE_WATCHER
+#define _H_FILE_WATCHER
+
+#include <string>
+#include <windows.h>
+
+using namespace std;
+
+/**
+ * Tells when a file was changed, by comparing its last write time and size between calls.
+ * A change is only reported once the file looks the same on two calls in a row,
+ * so a file that is still being saved is not read half written.
+ */
+class File_Watcher{
+  string m_path; // the file.
+  unsigned long long m_seen; // the stamp the caller was last told about.
+  unsigned long long m_last; // the stamp of the last call.
+
+public:
+  /**
+   * Constructor. The file as it is now counts as seen.
+   * string path: the file.
+   */
+  File_Watcher(string path){
+    m_path = path;
+    m_seen = get_stamp();
+    m_last = m_seen;
+  }
+
+  /**
+   * Checks the file. Call it at an interval.
+   * bool return: true if the file was changed since the last time this returned true, and has not changed since the last call.
+   */
+  bool changed(){
+    unsigned long long stamp = get_stamp();
+    bool ret = stamp != m_seen && stamp == m_last && stamp != 0;
+    m_last = stamp;
+    if(ret){
+      LOG("File_Watcher " << this << " >> changed(): " << m_path << " was changed.");
+      m_seen = stamp;
+    }
+    return ret;
+  }
+
+private:
+  /**
+   * Gets a number that changes whenever the file is written.
+   * unsigned long long return: the last write time mixed with the size. 0 if the file could not be read.
+   */
+  unsigned long long get_stamp(){
+    WIN32_FILE_ATTRIBUTE_DATA data;
+    if(!GetFileAttributesExA(m_path.c_str(), GetFileExInfoStandard, &data)) return 0;
+    unsigned long long time = ((unsigned long long) data.ftLastWriteTime.dwHighDateTime << 32) | data.ftLastWriteTime.dwLowDateTime;
+    return time ^ ((unsigned long long) data.nFileSizeHigh << 32 | data.nFileSizeLow) * 0x9E3779B97F4A7C15ULL;
+  }
+};
+
+#endif
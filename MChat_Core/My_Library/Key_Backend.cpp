@@ -0,0 +1,124 @@
+#include "LOG.hpp"
+
+#ifndef _H_KEY_BACKEND
+#define _H_KEY_BACKEND
+
+#include <vector>
+#include <algorithm>
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+using namespace std;
+
+/**
+ * One simulated key press or release.
+ */
+struct Key_Event{
+  unsigned short code; // the virtual key code, or a UTF-16 code unit if unicode is true.
+  bool up; // true for the release, false for the press.
+  bool unicode = false; // types code as a character instead of pressing a key.
+};
+
+/**
+ * Interface for classes that emit simulated keyboard input.
+ * A sender hands over every key of a message at once, so the backend decides how to submit and pace them.
+ */
+class Key_Backend{
+public:
+  virtual ~Key_Backend(){}
+
+  /**
+   * Emits key events in order.
+   * const vector<Key_Event> &events: the events.
+   */
+  virtual void send(const vector<Key_Event> &events) = 0;
+};
+
+#ifdef _WIN32
+/**
+ * A Key_Backend that submits the events to Windows with SendInput(), a batch of them per call,
+ * instead of one keybd_event() call and one Sleep() per key.
+ * SendInput() inserts a batch into the input stream as a whole, so no real keystroke can land in the middle of it.
+ */
+class SendInput_Backend : public Key_Backend{
+  int m_batch; // the most events per SendInput() call. 0 for every event in one call.
+  int m_delay; // the pause between two batches. in milliseconds.
+  vector<INPUT> m_inputs; // reused between calls.
+
+public:
+  /**
+   * Constructor
+   * int batch: the most events per SendInput() call. 0 for every event in one call.
+   * int delay: the pause between two batches. in milliseconds.
+   */
+  SendInput_Backend(int batch, int delay){
+    LOG("SendInput_Backend " << this << " >> new. batch: " << batch << ", delay: " << delay);
+    m_batch = batch;
+    m_delay = delay;
+  }
+
+  void send(const vector<Key_Event> &events){
+    size_t batch = m_batch > 0 ? m_batch : events.size();
+    for(size_t first = 0; first < events.size(); first += batch){
+      if(first > 0) Sleep(m_delay);
+      size_t count = min(batch, events.size() - first);
+      m_inputs.assign(count, INPUT());
+      for(size_t i = 0; i < count; i++){
+        m_inputs[i].type = INPUT_KEYBOARD;
+        const Key_Event &event = events[first + i];
+        if(event.unicode){
+          m_inputs[i].ki.wScan = event.code;
+          m_inputs[i].ki.dwFlags = KEYEVENTF_UNICODE | (event.up ? KEYEVENTF_KEYUP : 0);
+        }else{
+          m_inputs[i].ki.wVk = event.code;
+          m_inputs[i].ki.dwFlags = KEYEVENTF_EXTENDEDKEY | (event.up ? KEYEVENTF_KEYUP : 0);
+        }
+      }
+      UINT sent = SendInput(count, m_inputs.data(), sizeof(INPUT));
+      if(sent != count){ // blocked by another thread or by a window of a higher integrity level.
+        LOG("SendInput_Backend " << this << " >> send(): only " << sent << " of " << count << " events were sent.");
+      }
+    }
+  }
+};
+#endif
+
+/**
+ * A Key_Backend that keeps the events in order instead of sending them, and counts the send() calls.
+ */
+class Recording_Backend : public Key_Backend{
+  vector<Key_Event> m_events; // every event so far.
+  size_t m_calls; // the number of send() calls so far.
+
+public:
+  /**
+   * Constructor
+   */
+  Recording_Backend(){
+    m_calls = 0;
+  }
+
+  void send(const vector<Key_Event> &events){
+    m_events.insert(m_events.end(), events.begin(), events.end());
+    m_calls++;
+  }
+
+  /** get every event so far */
+  const vector<Key_Event> &get_events() const {
+    return m_events;
+  }
+
+  /** get the number of send() calls so far. one per message, plus the window switches. */
+  size_t get_calls() const {
+    return m_calls;
+  }
+
+  /** forgets every event so far */
+  void clear(){
+    m_events.clear();
+    m_calls = 0;
+  }
+};
+
+#endif
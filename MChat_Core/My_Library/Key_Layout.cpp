@@ -0,0 +1,95 @@
+#include "LOG.hpp"
+
+#ifndef _H_KEY_LAYOUT
+#define _H_KEY_LAYOUT
+
+#include <string>
+#include <array>
+
+#define LAYOUT_US 0 // the US keyboard.
+#define LAYOUT_JIS 1 // the Japanese keyboard.
+#ifndef KEY_LAYOUT
+#define KEY_LAYOUT LAYOUT_US // the keyboard layout of the machine that types. build with -DKEY_LAYOUT=LAYOUT_JIS to change it.
+#endif
+
+using namespace std;
+
+/**
+ * The key that types a character, and whether shift is held down for it.
+ */
+struct Key_Stroke{
+  unsigned char code; // the virtual key code. 0 if no key types the character.
+  bool shift;
+};
+
+/**
+ * A key of a keyboard layout that types a symbol.
+ */
+struct Key_Row{
+  unsigned char code; // the virtual key code.
+  char normal; // the character it types. 0 if none.
+  char shifted; // the character it types with shift. 0 if none.
+};
+
+constexpr Key_Row US_KEYS[] = {
+  {48, '0', ')'}, {49, '1', '!'}, {50, '2', '@'}, {51, '3', '#'}, {52, '4', '$'},
+  {53, '5', '%'}, {54, '6', '^'}, {55, '7', '&'}, {56, '8', '*'}, {57, '9', '('},
+  {186, ';', ':'}, {187, '=', '+'}, {188, ',', '<'}, {189, '-', '_'}, {190, '.', '>'},
+  {191, '/', '?'}, {192, '`', '~'}, {219, '[', '{'}, {220, '\\', '|'}, {221, ']', '}'},
+  {222, '\'', '\"'}
+};
+
+constexpr Key_Row JIS_KEYS[] = {
+  {48, '0', 0}, {49, '1', '!'}, {50, '2', '\"'}, {51, '3', '#'}, {52, '4', '$'},
+  {53, '5', '%'}, {54, '6', '&'}, {55, '7', '\''}, {56, '8', '('}, {57, '9', ')'},
+  {186, ':', '*'}, {187, ';', '+'}, {188, ',', '<'}, {189, '-', '='}, {190, '.', '>'},
+  {191, '/', '?'}, {192, '@', '`'}, {219, '[', '{'}, {220, 0, '|'}, {221, ']', '}'},
+  {222, '^', '~'}, {226, '\\', '_'}
+};
+
+/**
+ * Builds the table from a byte to the key that types it on a keyboard layout.
+ * Only printable ASCII, space and the line break have keys. Every other byte is left at code 0.
+ * int layout: LAYOUT_US or LAYOUT_JIS.
+ */
+constexpr array<Key_Stroke, 256> make_key_table(int layout){
+  array<Key_Stroke, 256> table{};
+  for(int c = 'a'; c <= 'z'; c++) table[c] = Key_Stroke{(unsigned char) (c - 32), false};
+  for(int c = 'A'; c <= 'Z'; c++) table[c] = Key_Stroke{(unsigned char) c, true};
+  table[' '] = Key_Stroke{32, false};
+  table['\n'] = Key_Stroke{13, false}; // enter key.
+
+  const Key_Row *rows = layout == LAYOUT_JIS ? JIS_KEYS : US_KEYS;
+  size_t count = layout == LAYOUT_JIS ? sizeof(JIS_KEYS) / sizeof(Key_Row) : sizeof(US_KEYS) / sizeof(Key_Row);
+  for(size_t i = 0; i < count; i++){
+    if(rows[i].normal != 0) table[(unsigned char) rows[i].normal] = Key_Stroke{rows[i].code, false};
+    if(rows[i].shifted != 0) table[(unsigned char) rows[i].shifted] = Key_Stroke{rows[i].code, true};
+  }
+  return table;
+}
+
+/** the keys of the KEY_LAYOUT layout. */
+constexpr array<Key_Stroke, 256> KEY_TABLE = make_key_table(KEY_LAYOUT);
+
+/**
+ * Reads the code point of a UTF-8 character.
+ * const string &s: the string.
+ * size_t &position: the first byte of the character. set to the first byte of the next one.
+ * unsigned int return: the code point. an invalid byte is skipped and returned as 0xFFFD, the replacement character.
+ */
+inline unsigned int decode_utf8(const string &s, size_t &position){
+  unsigned char c = s[position++];
+  if(c < 0x80) return c;
+  size_t length = c >= 0xF8 ? 0 : c >= 0xF0 ? 4 : c >= 0xE0 ? 3 : c >= 0xC0 ? 2 : 0;
+  if(length == 0 || position + length - 1 > s.size()) return 0xFFFD;
+  unsigned int point = c & (0x7F >> length);
+  for(size_t i = 1; i < length; i++){
+    unsigned char next = s[position];
+    if((next & 0xC0) != 0x80) return 0xFFFD; // cut off. the next character starts here.
+    point = point << 6 | (next & 0x3F);
+    position++;
+  }
+  return point;
+}
+
+#endif
@@ -4,13 +4,27 @@
 #define _H_LANGUAGE
 
 #include <iostream>
-#include <map>
-#include <list>
+#include <vector>
+#include <algorithm>
+#include <cmath>
 #include <windows.h>
 #include <chrono>
 #include <random>
 #include <sstream>
 #include <fstream>
+#include <thread>
+#include <string_view>
+#include <charconv>
+#include <memory>
+
+#include "Mapped_File.cpp"
+#include "Tokenizer.cpp"
+#include "Token_Table.cpp"
+#include "Context_Table.cpp"
+#include "Transition_Table.cpp"
+#include "Model_File.cpp"
+#include "Transition_Runs.cpp"
+#include "Transition_Sketch.cpp"
 
 #define TK_START "START_OF_SENTENCE_UD8a6TXfemyfJItNEJR7"
 #define TK_END "END_OF_SENTENCE_NKlykNp6QsY4u3XF2V2R"
@@ -18,105 +32,153 @@
 using namespace std;
 
 /**
- * A class used in Language. Used to count how many times a word was used after a word.
+ * Settings for how a Language learns.
  */
-class Word{
-  string word; // a word in a language
-  int count; // the count a word is used after a word in a language
-
-public:
-  /**
-   * Constuctor
-   * string s: a word in a language
-   */
-  Word(string s){
-    word = s;
-    count = 1;
-  }
-
-  Word(){
-    word = "dummy";
-    count = 0;
-  }
-
-  Word(string s, int i){
-    word = s;
-    count = i;
-  }
-
-  /** increases the word count by 1 */
-  void add(){
-    count++;
-  }
-
-  /** get word*/
-  string get_word(){
-    return word;
-  }
-
-  /** get count */
-  int get_count(){
-    return count;
-  }
+struct Language_Options{
+  int learn_threads = 1; // the number of threads learn_file() uses.
+  int order = 1; // the number of previous words a word depends on. 1 to MAX_ORDER.
+  string delimiters = DEFAULT_DELIMITERS; // every character that separates two words.
+  size_t memory_budget = 0; // the memory for counting transitions in learn_file(), in bytes. 0 means unlimited.
+  bool approximate = false; // with a memory budget, keep only the most frequent transitions instead of spilling to disk.
 };
 
 /**
  * Language class is responsible for learning a language from file and generating text.
  * can also input/output a known language to a file for the archives.
  * uses markov's chain in order to learn languages.
+ * Words are interned into ids and every state is a context of the last 1 to order words.
+ * Every context up to the order is learned, so generation can back off to a shorter context
+ * when a longer one has no successors.
  */
 class Language{
-  map<string, list<Word>> dictionary; // the dictionary.
+  Language_Options m_options; // how to learn.
+  Tokenizer m_tokenizer; // splits lines into words.
+  Token_Table m_tokens; // every word known by the language.
+  Context_Table m_contexts; // every context known by the language. the states of the chain.
+  Transition_Table m_transitions; // how many times each word came after each context.
+  unique_ptr<Mapped_File> m_model_file; // the compiled model file the tables are attached to. NULL if none.
+  string m_temp_model; // a temporary model file written by learn_file() that is deleted with the language. empty if none.
+  Transition_Sink *m_sink; // counts the transitions instead of m_contexts and m_transitions while learning with a memory budget. NULL if none.
+  uint32_t m_start; // id of TK_START.
+  uint32_t m_end; // id of TK_END.
+  int m_order; // the longest context that is learned and used for generation.
 
 public:
   /** Constructor */
-  Language(){
+  Language(Language_Options options = Language_Options()) : m_options(options), m_tokenizer(options.delimiters){
     LOG("Language " << this << " >> new.");
-    list<Word> t_list;
-    dictionary[TK_START] = t_list;
+    m_start = m_tokens.intern(TK_START);
+    m_end = m_tokens.intern(TK_END);
+    m_contexts.intern(&m_start, 1);
+    m_order = max(1, min(options.order, MAX_ORDER));
+    m_sink = NULL;
+    m_transitions.compile(m_contexts.size());
   }
 
+  /** Destructor. Deletes the temporary model file once it is unmapped. */
+  ~Language(){
+    m_model_file.reset();
+    if(!m_temp_model.empty()) DeleteFileA(m_temp_model.c_str());
+  }
+
+  Language(const Language&) = delete;
+  Language &operator=(const Language&) = delete;
+
   /**
-   * Learns a language from a sample text file.
+   * Learns a language from a sample text file. The file is memory mapped and tokenized in place.
+   * If more than one learn thread is set, the file is split into that many line-aligned chunks
+   * which are learned separately and merged in order, so the result is the same for any number of threads.
+   * A compiled model file (see save_model()) is used straight from the mapping instead, whatever is_dictionary is.
+   * With a memory budget the file is learned on one thread by learn_bounded() instead.
    * string path: path to the sample text file.
    * bool dictionary: will read learning file as a dictionary file if true.
    */
   void learn_file(string path, bool is_dictionary){
     LOG("Language " << this << " >> learn_file(): Learning language... This may take a while.");
-    ifstream sample(path);
-    string line;
-    if(sample.is_open()){
-      while(getline(sample, line)){
-        if(!is_dictionary){
-          if(line != "") learn_sentence(line);
-        }else{
-          if(line != "") read_dictionary_line(line);
-        }
-      }
-      sample.close();
-    }else{
+    unique_ptr<Mapped_File> sample(new Mapped_File(path));
+    if(!(*sample).is_open()){
       LOG("Language " << this << " >> learn_file(): error reading sample file. Closing program...");
       Sleep(5000);
       exit(1);
     }
-    LOG("Language " << this << " >> learn_file(): Done.");
+    string_view text = (*sample).view();
+
+    if(Model_File::is_model(text)){
+      load_model(move(sample));
+      return;
+    }
+
+    if(m_options.memory_budget > 0){
+      learn_bounded(text, is_dictionary);
+      return;
+    }else if(m_options.learn_threads <= 1){
+      learn_chunk(text, is_dictionary);
+    }else{
+      vector<size_t> bounds = split_lines(text, m_options.learn_threads);
+      vector<Language*> workers;
+      vector<thread> pool;
+      for(size_t i = 0; i + 1 < bounds.size(); i++){
+        workers.push_back(new Language(m_options));
+        pool.push_back(thread(&Language::learn_chunk, workers.back(), text.substr(bounds[i], bounds[i + 1] - bounds[i]), is_dictionary));
+      }
+      for(size_t i = 0; i < pool.size(); i++){
+        pool[i].join();
+        merge_counts(*workers[i]);
+        delete workers[i];
+      }
+      LOG("Language " << this << " >> learn_file(): merged " << pool.size() << " chunks.");
+    }
+    m_transitions.compile(m_contexts.size());
+    LOG("Language " << this << " >> learn_file(): Done. " << m_tokens.size() << " words, " << m_contexts.size() << " contexts, " << m_transitions.size() << " transitions.");
+  }
+
+  /**
+   * Writes the language as a compiled model file that learn_file() can map and use without parsing.
+   * string path: the file to write.
+   * bool return: false if the file could not be written.
+   */
+  bool save_model(string path){
+    if(!m_transitions.is_compiled()) m_transitions.compile(m_contexts.size());
+    bool ret = Model_File::write(path, m_order, m_tokens, m_contexts, m_transitions);
+    LOG("Language " << this << " >> save_model(): " << path << (ret ? "" : " could not be written."));
+    return ret;
+  }
+
+  /**
+   * Adds everything another language has learned to this one.
+   * Words, contexts and transitions new to this language are added in the order the other language first saw them.
+   * const Language &other: the language to merge.
+   */
+  void merge(const Language &other){
+    merge_counts(other);
+    m_transitions.compile(m_contexts.size());
   }
 
   /**
    * Will generate a single sentence from the current dictionary.
+   * Only reads the language, so any number of threads can generate from the same language at once.
    * string return: the generated sentence.
    */
-  string generate_sentence(){
+  string generate_sentence() const {
     unsigned seed = std::chrono::system_clock::now().time_since_epoch().count();
-    std::mt19937 generator(seed);
-    string word = TK_START;
+    std::mt19937_64 generator(seed);
+    return generate_sentence(generator);
+  }
+
+  /**
+   * Will generate a single sentence from the current dictionary with the given RNG.
+   * mt19937_64 &generator: the RNG. only this call may use it while it runs.
+   * string return: the generated sentence.
+   */
+  string generate_sentence(mt19937_64 &generator) const {
+    uint32_t history[MAX_ORDER] = {m_start}; // the last words, oldest first.
+    int length = 1;
     string sentence;
-    double rnd;
     while(true){
-      rnd = (double) generator() / generator.max();
-      word = generate_next(word, rnd);
-      if(word == TK_END) break;
-      sentence.append(word);
+      uint32_t word = generate_next(history, length, generator());
+      if(word == m_end) break;
+      push_history(history, length, word);
+      sentence.append(m_tokens.get_word(word));
       sentence.append(" ");
     }
     LOG("Language " << this << " >> generate_sentence(): " << sentence);
@@ -127,19 +189,33 @@ public:
 
   /**
    * will return the dictionary's data as a string.
+   * one line per context: "word word ...: next_word count next_word count ..."
    * string return: data of the dictionary.
    */
-  string show_dictionary(){
+  string show_dictionary() const {
+    vector<pair<string, uint32_t>> states; // every state with successors, sorted by context.
+    for(uint32_t state = 0; state < m_contexts.size(); state++){
+      if(state == 0 || m_transitions.successor_begin(state) != m_transitions.successor_end(state)){
+        string key;
+        for(int i = 0; i < m_contexts.get_order(state); i++){
+          if(i > 0) key.append(" ");
+          key.append(m_tokens.get_word(m_contexts.get_context(state)[i]));
+        }
+        states.push_back(make_pair(key, state));
+      }
+    }
+    sort(states.begin(), states.end());
+
     string ret;
-    for(auto it = dictionary.begin(); it != dictionary.end(); it++){
-      ret.append((*it).first);
+    for(auto &entry : states){
+      uint32_t state = entry.second;
+      ret.append(entry.first);
       ret.append(":");
-      for(auto itr = (*it).second.begin(); itr != (*it).second.end(); itr++){
+      for(uint32_t i = m_transitions.successor_begin(state); i < m_transitions.successor_end(state); i++){
         ret.append(" ");
-        ret.append((*itr).get_word());
+        ret.append(m_tokens.get_word(m_transitions.get_next(i)));
         ret.append(" ");
-        ret.append(to_string((*itr).get_count()));
-
+        ret.append(to_string(m_transitions.get_next_count(i)));
       }
       ret.append("\n");
     }
@@ -149,167 +225,246 @@ public:
 
 private:
   /**
-   * Adds a word into a list.
-   * list<Word> *list: the list to add the word.
-   * string next_token: the word to be added. this word should be the next token that comes after the owner of the list.
+   * Adds the counts of another language to this one without compiling. see merge().
+   * const Language &other: the language to merge.
    */
-  void list_add_word(list<Word> *list, string next_token){
-    for(auto itr = (*list).begin(); true ; itr++){
-
-      if(itr == (*list).end()){ // if the word in a list is NOT found, will add a new Word.
-        (*list).push_back(Word(next_token));
-        //LOG("Language >> Learn_sentence(): new word");
-        break;
-
-      }else if((*itr).get_word() == next_token){ // if the word in a list is found, increment it's count.
-        (*itr).add();
-        LOG("Language >> Learn_sentence(): add word");
-        break;
+  void merge_counts(const Language &other){
+    vector<uint32_t> ids(other.m_tokens.size()); // id in other -> id in this.
+    for(uint32_t id = 0; id < other.m_tokens.size(); id++){
+      ids[id] = m_tokens.intern(other.m_tokens.get_word(id));
+    }
+    vector<uint32_t> states(other.m_contexts.size()); // state in other -> state in this.
+    for(uint32_t state = 0; state < other.m_contexts.size(); state++){
+      uint32_t context[MAX_ORDER];
+      int order = other.m_contexts.get_order(state);
+      for(int i = 0; i < order; i++){
+        context[i] = ids[other.m_contexts.get_context(state)[i]];
       }
+      states[state] = m_contexts.intern(context, order);
     }
-  }
-  /** will also add the count when adding the word */
-  void list_add_word(list<Word> *list, string next_token, int count){
-    for(auto itr = (*list).begin(); true ; itr++){
-
-      if(itr == (*list).end()){ // if the word in a list is NOT found, will add a new Word.
-        (*list).push_back(Word(next_token, count));
-        //LOG("Language >> Learn_sentence(): new word");
-        break;
-
-      }else if((*itr).get_word() == next_token){ // if the word in a list is found, increment it's count.
-        (*itr).add();
-        LOG("Language >> Learn_sentence(): add word");
-        break;
+    if(other.m_transitions.is_attached()){
+      for(uint32_t s = 0; s < other.m_transitions.get_state_count(); s++){
+        for(uint32_t i = other.m_transitions.successor_begin(s); i < other.m_transitions.successor_end(s); i++){
+          m_transitions.add(states[s], ids[other.m_transitions.get_next(i)], other.m_transitions.get_next_count(i));
+        }
+      }
+    }else{
+      for(size_t i = 0; i < other.m_transitions.size(); i++){
+        m_transitions.add(states[other.m_transitions.get_from(i)], ids[other.m_transitions.get_to(i)], other.m_transitions.get_count(i));
       }
     }
+    m_order = max(m_order, other.m_order);
   }
 
   /**
-   * Finds a word and returns the word cout of that word in a list.
-   * list<Word> *list: the list to find the word.
-   * string token: the search word.
-   * int return: will return -1 if not found. otherwise will return the word count.
+   * Uses a mapped compiled model file. If nothing was learned yet the tables are attached to the mapping,
+   * otherwise the model is merged into what was learned.
+   * unique_ptr<Mapped_File> file: the mapped model file.
+   * bool return: true if the tables are attached to the file, false if it was merged and can be closed.
    */
-  int list_find_word(list<Word> *list, string token){
-    for(auto itr = (*list).begin(); true ; itr++){
-      if(itr == (*list).end()){ // if the word in a list is NOT found, returns -1.
-        return -1;
-      }else if((*itr).get_word() == token){ // if the word in a list is found, return the string.
-        return (*itr).get_count();
+  bool load_model(unique_ptr<Mapped_File> file){
+    if(m_transitions.size() == 0 && m_contexts.size() == 1 && m_model_file == NULL){
+      if(!Model_File::attach((*file).view(), m_order, m_tokens, m_contexts, m_transitions) || m_tokens.size() < 2 || m_tokens.get_word(m_start) != TK_START || m_tokens.get_word(m_end) != TK_END){
+        LOG("Language " << this << " >> load_model(): invalid model file. Closing program...");
+        Sleep(5000);
+        exit(1);
       }
+      m_model_file = move(file);
+      LOG("Language " << this << " >> load_model(): Done. " << m_tokens.size() << " words, " << m_transitions.size() << " transitions.");
+      return true;
     }
+    Language model(m_options);
+    model.load_model(move(file));
+    merge(model);
+    return false;
   }
 
   /**
-   * Returns the total sum of word counts in this list.
-   * list<Word> *list: the list to get the total word count sum.
-   * int return: will return the sum of word counts.
+   * Learns a text while counting transitions within m_options.memory_budget. Only the words are kept in memory.
+   * The exact mode spills sorted runs of transitions to temporary files, merges them and writes a temporary model file
+   * that is mapped like any other. The approximate mode keeps the most frequent transitions in a count-min sketch
+   * and drops the rest.
+   * string_view text: the text.
+   * bool is_dictionary: will read the lines as dictionary lines if true.
    */
-  int list_total_count(list<Word> *list){
-    int sum = 0;
-    for(auto it = (*list).begin(); it != (*list).end(); it++){
-      sum += (*it).get_count();
+  void learn_bounded(string_view text, bool is_dictionary){
+    if(m_options.approximate){
+      Transition_Sketch sketch(m_options.memory_budget);
+      m_sink = &sketch;
+      learn_chunk(text, is_dictionary);
+      m_sink = NULL;
+      for(const Transition_Record &r : sketch.get_records()){
+        m_transitions.add(m_contexts.intern(r.context, r.get_order()), r.next, r.count);
+      }
+      m_transitions.compile(m_contexts.size());
+      LOG("Language " << this << " >> learn_bounded(): Done. " << m_tokens.size() << " words, " << m_contexts.size() << " contexts, " << m_transitions.size() << " transitions.");
+      return;
+    }
+
+    Transition_Runs runs(m_options.memory_budget);
+    m_sink = &runs;
+    learn_chunk(text, is_dictionary);
+    m_sink = NULL;
+    string model_path = Transition_Runs::make_temp_path();
+    if(!Model_File::write_sorted(model_path, m_order, m_tokens, runs.finish())){
+      DeleteFileA(model_path.c_str());
+      LOG("Language " << this << " >> learn_bounded(): error writing " << model_path << ". Closing program...");
+      Sleep(5000);
+      exit(1);
+    }
+    unique_ptr<Mapped_File> model(new Mapped_File(model_path));
+    if(!(*model).is_open()){
+      LOG("Language " << this << " >> learn_bounded(): error reading " << model_path << ". Closing program...");
+      Sleep(5000);
+      exit(1);
+    }
+    bool attached = load_model(move(model));
+    if(attached && m_temp_model.empty()){
+      m_temp_model = model_path;
+    }else{
+      DeleteFileA(model_path.c_str());
     }
-    return sum;
   }
 
   /**
-   * Will generate a single sentence using the current dictionary.
-   * string return: the generated sentence.
+   * Learns every line in a text.
+   * string_view text: the text. must start at the start of a line.
+   * bool is_dictionary: will read the lines as dictionary lines if true.
    */
-  string generate_next(string token, double rnd){
-    auto it = dictionary.find(token);
-    if(it != dictionary.end()){
-      int total_count = list_total_count(&((*it).second));
-      int r_count = round(total_count * rnd);
-      int count = 0;
-      list<Word>::iterator itr;
-      for(itr = (*it).second.begin(); itr != (*it).second.end(); itr++){
-        count += (*itr).get_count();
-        if(r_count <= count) break;
+  void learn_chunk(string_view text, bool is_dictionary){
+    while(!text.empty()){
+      size_t line_end = text.find('\n');
+      if(line_end == string_view::npos) line_end = text.size();
+      if(!is_dictionary){
+        learn_sentence(text.substr(0, line_end));
+      }else{
+        read_dictionary_line(text.substr(0, line_end));
       }
-
-      return (*itr).get_word();
-    }else{
-      LOG("Language " << this << " >> generate_next() error.");
-      exit(1);
+      text.remove_prefix(min(line_end + 1, text.size()));
     }
   }
 
   /**
-   * Reads one line from a dictionary file.
-   * string s: a line.
+   * Splits a text into line-aligned chunks of about the same size.
+   * string_view text: the text.
+   * int count: the number of chunks.
+   * vector<size_t> return: the bounds of the chunks. chunk i is [return[i], return[i + 1]).
    */
-  void read_dictionary_line(string s){
-    stringstream ss(s);
-    string token, f_token;
-    list<string> tokens;
-    int count;
-    map<string, list<Word>>::iterator it;
-
-    while(getline(ss, token, ' ')){ // divide string by space.
-      tokens.push_back(token);
+  static vector<size_t> split_lines(string_view text, int count){
+    vector<size_t> bounds;
+    bounds.push_back(0);
+    for(int i = 1; i < count; i++){
+      size_t pos = text.find('\n', max(bounds.back(), text.size() * i / count));
+      if(pos == string_view::npos) break;
+      bounds.push_back(pos + 1);
     }
+    bounds.push_back(text.size());
+    return bounds;
+  }
 
-    f_token = tokens.front();
-    tokens.pop_front();
-    f_token.erase(f_token.end() - 1);
-
-    list<Word> t_list;
-    dictionary[f_token] = t_list;
-
-    while(!tokens.empty()){
-      token = tokens.front();
-      tokens.pop_front();
-      count = atoi(tokens.front().c_str());
-      tokens.pop_front();
-      it = dictionary.find(f_token);
-      list_add_word(&((*it).second), token, count);
+  /**
+   * Will pick the word that comes after the last words. Backs off to shorter contexts
+   * until one with successors is found.
+   * const uint32_t *history: the last words, oldest first.
+   * int length: the number of words in history.
+   * uint64_t rnd: a uniformly random 64 bit number.
+   * uint32_t return: the next word.
+   */
+  uint32_t generate_next(const uint32_t *history, int length, uint64_t rnd) const {
+    for(int order = min(length, m_order); order >= 1; order--){
+      int64_t state = m_contexts.find(history + length - order, order);
+      if(state >= 0 && m_transitions.successor_begin(state) != m_transitions.successor_end(state)){
+        return m_transitions.get_next(m_transitions.sample(state, rnd));
+      }
     }
+    return m_end; // a pruned model can reach a word whose contexts were all dropped.
   }
 
   /**
-   * Learns a single sentence
-   * string s: the sentence to be learned.
+   * Appends a word to the last words, dropping the oldest one if there are more than m_order.
+   * uint32_t *history: the last words, oldest first.
+   * int &length: the number of words in history.
+   * uint32_t word: the new word.
    */
-  void learn_sentence(string s){
-    stringstream ss(s);
-    string token;
-    list<string> tokens;
-    map<string, list<Word>>::iterator it;
-
-    while(getline(ss, token, ' ')){ // divide string by space.
-      tokens.push_back(token);
+  void push_history(uint32_t *history, int &length, uint32_t word) const {
+    if(length == m_order){
+      for(int i = 1; i < length; i++) history[i - 1] = history[i];
+      length--;
     }
+    history[length++] = word;
+  }
 
-    it = dictionary.find(TK_START);
-    list_add_word(&((*it).second), tokens.front());
-
-    while(!tokens.empty()){
-      token = tokens.front();
-      tokens.pop_front();
-
-      string next_token;
-      if(!tokens.empty()){
-        next_token = tokens.front();
+  /**
+   * Counts a word after every context that ends at the last words.
+   * const uint32_t *history: the last words, oldest first.
+   * int length: the number of words in history.
+   * uint32_t word: the word that came after them.
+   */
+  void add_transitions(const uint32_t *history, int length, uint32_t word){
+    for(int order = 1; order <= length; order++){
+      if(m_sink != NULL){
+        (*m_sink).add(history + length - order, order, word, 1);
       }else{
-        next_token = TK_END;
+        m_transitions.add(m_contexts.intern(history + length - order, order), word);
       }
+    }
+  }
 
-      LOG("Language >> Learn_sentence(): " << token << " -> " << next_token);
-      it = dictionary.find(token);
-      if(it != dictionary.end()){ // if the list is found, proceed to add the word to the list.
-        list_add_word(&((*it).second), next_token);
-
-      }else{ // if the list is NOT found, create a new list and add to map.
-        LOG("Language >> Learn_sentence(): new list");
-        list<Word> t_list;
-        t_list.push_back(Word(next_token));
-        dictionary[token] = t_list;
+  /**
+   * Reads one line from a dictionary file. Lines without a context are skipped.
+   * string_view s: a line. "word word ...: next_word count next_word count ..."
+   */
+  void read_dictionary_line(string_view s){
+    string_view token, count;
+    uint32_t context[MAX_ORDER];
+    int order = 0;
+    while(true){
+      if(!m_tokenizer.next(s, token)) return;
+      if(order == MAX_ORDER){
+        LOG("Language " << this << " >> read_dictionary_line(): context is longer than " << MAX_ORDER << " words. skipped.");
+        return;
+      }
+      bool last = token.back() == ':';
+      if(last) token.remove_suffix(1);
+      context[order++] = m_tokens.intern(token);
+      if(last) break;
+    }
+    uint32_t from = m_sink == NULL ? m_contexts.intern(context, order) : 0;
+    m_order = max(m_order, order);
+
+    while(m_tokenizer.next(s, token) && m_tokenizer.next(s, count)){
+      uint32_t n = 0;
+      from_chars_result result = from_chars(count.data(), count.data() + count.size(), n);
+      if(result.ec != errc() || result.ptr != count.data() + count.size()){
+        LOG("Language " << this << " >> read_dictionary_line(): invalid count \"" << count << "\". skipped.");
+        continue;
+      }
+      if(m_sink != NULL){
+        (*m_sink).add(context, order, m_tokens.intern(token), n);
+      }else{
+        m_transitions.add(from, m_tokens.intern(token), n);
       }
     }
   }
+
+  /**
+   * Learns a single sentence. Lines without a word are skipped.
+   * string_view s: the sentence to be learned.
+   */
+  void learn_sentence(string_view s){
+    string_view token;
+    uint32_t history[MAX_ORDER] = {m_start}; // the last words, oldest first.
+    int length = 1;
+    bool empty = true;
+
+    while(m_tokenizer.next(s, token)){
+      uint32_t id = m_tokens.intern(token);
+      add_transitions(history, length, id);
+      push_history(history, length, id);
+      empty = false;
+    }
+    if(!empty) add_transitions(history, length, m_end);
+  }
 };
 
 #endif
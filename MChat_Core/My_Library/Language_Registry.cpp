@@ -0,0 +1,130 @@
+#include "LOG.hpp"
+
+#ifndef _H_LANGUAGE_REGISTRY
+#define _H_LANGUAGE_REGISTRY
+
+#include <string>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <future>
+#include <thread>
+#include <cctype>
+#include <windows.h>
+
+#include "Language.cpp"
+
+using namespace std;
+
+/**
+ * Process-wide cache of learned languages, so a corpus that is used by several Markov_Generator objects
+ * is only learned and held in memory once. Languages are handed out as shared, immutable objects and
+ * are freed once nothing uses them anymore.
+ * Different files are learned at the same time when several threads ask for them, while a thread that
+ * asks for a language that is being learned waits for it instead of learning it again.
+ */
+class Language_Registry{
+public:
+  /**
+   * Gets the language learned from a file, learning it if nothing holds it yet.
+   * string path: path to the sample text file.
+   * bool is_dictionary: will read learning file as a dictionary file if true.
+   * Language_Options options: how to learn the file.
+   * shared_ptr<const Language> return: the learned language.
+   */
+  static shared_ptr<const Language> get(string path, bool is_dictionary, Language_Options options){
+    string key = make_key(path, is_dictionary, options);
+    promise<shared_ptr<const Language>> learned;
+    shared_future<shared_ptr<const Language>> learning;
+    {
+      lock_guard<mutex> lock(get_mutex());
+      shared_ptr<const Language> ret = get_languages()[key].lock();
+      if(ret){
+        LOG("Language_Registry >> get(): sharing " << ret.get() << " for " << key);
+        return ret;
+      }
+      auto itr = get_learning().find(key);
+      if(itr != get_learning().end()){
+        learning = (*itr).second;
+      }else{
+        get_learning().emplace(key, learned.get_future().share());
+      }
+    }
+    if(learning.valid()){ // another thread is learning it.
+      LOG("Language_Registry >> get(): waiting for " << key);
+      return learning.get();
+    }
+
+    shared_ptr<Language> language(new Language(options)); // learned without the lock, so other files are learned meanwhile.
+    (*language).learn_file(path, is_dictionary);
+    {
+      lock_guard<mutex> lock(get_mutex());
+      get_languages()[key] = language;
+      get_learning().erase(key);
+    }
+    learned.set_value(language);
+    return language;
+  }
+
+  /**
+   * Gets the language learned from a file on a detached thread, so the caller never waits for it.
+   * Dropping the returned future does not wait for the learning either, unlike a future of async().
+   * string path: path to the sample text file.
+   * bool is_dictionary: will read learning file as a dictionary file if true.
+   * Language_Options options: how to learn the file.
+   * shared_future<shared_ptr<const Language>> return: ready once the language is learned.
+   */
+  static shared_future<shared_ptr<const Language>> get_async(string path, bool is_dictionary, Language_Options options){
+    shared_ptr<promise<shared_ptr<const Language>>> learned(new promise<shared_ptr<const Language>>());
+    shared_future<shared_ptr<const Language>> ret = (*learned).get_future().share();
+    thread([learned, path, is_dictionary, options]{ (*learned).set_value(get(path, is_dictionary, options)); }).detach();
+    return ret;
+  }
+
+  /**
+   * Gets the key of a language: the canonical path of the file and every setting that changes what is learned.
+   */
+  static string make_key(string path, bool is_dictionary, Language_Options options){
+    string key = canonical_path(path);
+    key.append(is_dictionary ? " TRUE " : " FALSE ");
+    key.append(to_string(options.order));
+    key.append(" ");
+    key.append(options.delimiters);
+    key.append(" ");
+    key.append(to_string(options.memory_budget));
+    key.append(options.approximate ? " TRUE" : " FALSE");
+    return key;
+  }
+
+private:
+  /**
+   * Gets the full path of a file, lower case and with backslashes, so every way of writing it compares equal.
+   */
+  static string canonical_path(string path){
+    char full[MAX_PATH];
+    DWORD length = GetFullPathNameA(path.c_str(), MAX_PATH, full, NULL);
+    string ret = (length == 0 || length >= MAX_PATH) ? path : string(full, length);
+    for(unsigned int i = 0; i < ret.length(); i++){
+      if(ret[i] == '/') ret[i] = '\\';
+      ret[i] = tolower((unsigned char) ret[i]);
+    }
+    return ret;
+  }
+
+  static map<string, weak_ptr<const Language>> &get_languages(){
+    static map<string, weak_ptr<const Language>> languages;
+    return languages;
+  }
+
+  static map<string, shared_future<shared_ptr<const Language>>> &get_learning(){
+    static map<string, shared_future<shared_ptr<const Language>>> learning; // the languages that are being learned.
+    return learning;
+  }
+
+  static mutex &get_mutex(){
+    static mutex m;
+    return m;
+  }
+};
+
+#endif
@@ -0,0 +1,80 @@
+#include "LOG.hpp"
+
+#ifndef _H_MAPPED_FILE
+#define _H_MAPPED_FILE
+
+#include <string>
+#include <string_view>
+#include <windows.h>
+
+using namespace std;
+
+/**
+ * A read-only memory mapping of a whole file. The file is unmapped when the object is destroyed.
+ */
+class Mapped_File{
+  HANDLE m_file; // the opened file.
+  HANDLE m_mapping; // the file mapping object. NULL for empty files.
+  const char *m_data; // the mapped contents.
+  size_t m_size; // the size of the file in bytes.
+  bool m_open; // true if the file was mapped.
+
+public:
+  /**
+   * Constructor
+   * const string &path: path to the file to map.
+   */
+  Mapped_File(const string &path){
+    m_mapping = NULL;
+    m_data = NULL;
+    m_size = 0;
+    m_open = false;
+
+    m_file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if(m_file == INVALID_HANDLE_VALUE){
+      LOG("Mapped_File " << this << " >> new: could not open \"" << path << "\"");
+      return;
+    }
+
+    LARGE_INTEGER size;
+    if(!GetFileSizeEx(m_file, &size)){
+      LOG("Mapped_File " << this << " >> new: could not get the size of \"" << path << "\"");
+      return;
+    }
+    m_size = size.QuadPart;
+    if(m_size == 0){ // empty files can not be mapped.
+      m_open = true;
+      return;
+    }
+
+    m_mapping = CreateFileMappingA(m_file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if(m_mapping != NULL) m_data = (const char*) MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0);
+    if(m_data == NULL){
+      LOG("Mapped_File " << this << " >> new: could not map \"" << path << "\"");
+      return;
+    }
+    m_open = true;
+  }
+
+  Mapped_File(const Mapped_File&) = delete;
+  Mapped_File &operator=(const Mapped_File&) = delete;
+
+  /** Destructor */
+  ~Mapped_File(){
+    if(m_data != NULL) UnmapViewOfFile(m_data);
+    if(m_mapping != NULL) CloseHandle(m_mapping);
+    if(m_file != INVALID_HANDLE_VALUE) CloseHandle(m_file);
+  }
+
+  /** returns true if the file was mapped */
+  bool is_open() const {
+    return m_open;
+  }
+
+  /** get the contents of the file */
+  string_view view() const {
+    return string_view(m_data, m_size);
+  }
+};
+
+#endif
@@ -6,118 +6,139 @@
 #include <chrono>
 #include <iostream>
 #include <random>
+#include <future>
 
 #include "Message_Sender.cpp"
-#include "Language.cpp"
+#include "Schedule.cpp"
+#include "Language_Registry.cpp"
+#include "Sentence_Pool.cpp"
 
-#define QUANTUM_NUMBER 60 // an hour is divided into this number.
+#define LOAD_POLL_INTERVAL 1000 // how often a handler checks whether its language is learned. in milliseconds.
 
 using namespace std;
 
 /**
- * A data structure to take care of the weekly schedule.
+ * Interface for classes that recieves updates signals and
+ * queue mesages to Message_Sender class objects if necessary.
+ * Every update() returns the next time the handler has to be updated, so the caller can sleep until then.
  */
-class Schedule{
-  bool schedule_table[7][24 * QUANTUM_NUMBER]; // if this is set to true it means that the Message_Handler will send messages to the window.
+class Message_Handler {
+protected:
+  Schedule *m_schedule; // message sending schedule.
+  Message_Sender *m_ms; // messanger for the window.
+  int m_interval_min; // minimum message interval. in milliseconds. 300000 for 5 mins.
+  int m_interval_max; // maximum message interval. in milliseconds. 300000 for 5 mins.
+  long long m_next_message; // when the next message is due. in milliseconds since the epoch. 0 to send as soon as the schedule is on.
+  mt19937 m_generator; // RNG used for the interval randomizer.
+  int m_message_count; // the number of messages queued so far.
+  int m_skipped_count; // the number of messages skipped so far because the sender was saturated or the handler was not ready.
+  long long m_queue_time; // the real time spent in queue_next() so far. in nanoseconds.
 
 public:
+  /** Constructor */
+  Message_Handler(){
+    m_message_count = 0;
+    m_skipped_count = 0;
+    m_queue_time = 0;
+  }
+
+  /** Destructor */
+  virtual ~Message_Handler(){}
+
   /**
-   * Constructor
+   * Takes the current time. Will queue a message to its Message_Sender
+   * if one is due and the schedule is on.
+   * If the sender is saturated the message is skipped without generating it, and the next one is due as usual.
+   * long long now: the current time. in milliseconds since the epoch.
+   * long long return: when to call update() next. the next message, the next schedule change or what prepare() asked for, whichever comes first.
    */
-  Schedule(){
-    for(int i = 0; i < 7; i++){
-      for(int j = 0; j < 24 * QUANTUM_NUMBER; j++){
-        schedule_table[i][j] = false; // default is false. meaning no sending messages.
+  long long update(long long now){
+    long long off = (*m_schedule).next_off(now);
+    if(off == now){
+      m_next_message = 0; // resets timer when schedule is over.
+      long long on = (*m_schedule).next_on(now);
+      return min(on, prepare(now, on));
+    }
+    long long ready = prepare(now, now);
+    if(m_next_message <= now){
+      if((*m_ms).is_saturated()){
+        LOG("Message_Handler " << this << " >> update(): Message_Sender " << m_ms << " is saturated. skipped a message.");
+        m_skipped_count++;
+      }else{
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        bool queued = queue_next();
+        m_queue_time += chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count();
+        if(queued){
+          m_message_count++;
+        }else{
+          m_skipped_count++;
+        }
       }
+      set_next_message(now);
     }
-    LOG("Schedule " << this << " >> new: " << 7 << " " << 24 * QUANTUM_NUMBER);
+    return min(min(m_next_message, off), ready);
   }
 
   /**
-   * Sets schedule.
-   * int week: 0 = Mon, 1 = Tue, ... , 6 = Sun
-   * int time: 0:00 - 0:14 = 0, 0:15 - 0:29 = 1, ... , 23:45 - 23:59 = 23 * 4
-   * bool value: the value to set the schedule.
+   * Takes over when the next message is due from a handler that this one replaces, so a reload does not make
+   * every handler send as soon as it is swapped in.
+   * const Message_Handler &other: the handler with the same settings that is replaced.
    */
-  void set_schedule(int week, int time_frame, bool value){
-    check(week, time_frame);
-    schedule_table[week][time_frame] = value;
+  void continue_from(const Message_Handler &other){
+    m_next_message = other.m_next_message;
+    m_generator = other.m_generator;
   }
 
   /**
-   * Gets schedule.
-   * int week: 0 = Sun, 1 = Mon, ... , 6 = Sat
-   * int time: 0:00 - 0:14 = 0, 0:15 - 0:29 = 1, ... , 23:45 - 23:59 = 23 * 4
-   * bool return value: the value of the schedule.
+   * Changes the message sending schedule.
+   * Schedule *schedule: the new schedule.
    */
-  bool get_schedule(int week, int time_frame){
-    return schedule_table[week][time_frame];
+  void set_schedule(Schedule *schedule){
+    m_schedule = schedule;
   }
 
-private:
-  void check(int week, int time_frame){
-    if(week < 0 || 6 < week || time_frame < 0 || 24 * QUANTUM_NUMBER - 1 < time_frame){
-      LOG("Schedule " << this << " >> check(): argument was out of range. week: " << week << ", time_frame: " << time_frame);
-      exit(1);
-    }
+  /** get a short description of the handler for reports */
+  virtual string get_name() = 0;
+
+  /** get the number of messages queued so far */
+  int get_message_count(){
+    return m_message_count;
   }
-};
 
-//----------
+  /** get the number of messages skipped so far because the sender was saturated or the handler was not ready */
+  int get_skipped_count(){
+    return m_skipped_count;
+  }
 
-/**
- * Interface for classes that recieves updates signals and
- * queue mesages to Message_Sender class objects if necessary.
- */
-class Message_Handler {
-protected:
-  Schedule *m_schedule; // message sending schedule.
-  Message_Sender *m_ms; // messanger for the window.
-  int m_interval_min; // minimum message interval. in milliseconds. 300000 for 5 mins.
-  int m_interval_max; // maximum message interval. in milliseconds. 300000 for 5 mins.
-  int m_counter; // used to count how much time is left for the next message.
-  int m_next_counter; // the randomly generated interval.
-  tm m_previous; // used to store the tm when the previous call happened.
-  mt19937 m_generator; // RNG used for the interval randomizer.
+  /** get the real time spent generating and queueing messages so far. in nanoseconds. */
+  long long get_queue_time(){
+    return m_queue_time;
+  }
 
-public:
+protected:
   /**
-   * Takes tm of the current time. Will queue messages to its Message_Sender
-   * if necessary.
-   * tm *time: tm of the current time.
+   * Queues one message to m_ms.
+   * bool return: false if the handler was not ready and nothing was queued.
    */
-  virtual void update(tm *time) = 0;
+  virtual bool queue_next() = 0;
 
-protected:
   /**
-   * Updates the current counter. And will return true if it is time to queue a message.
-   * tm *time: current time.
-   * bool return: will return true if it is time to queue a message.
+   * Called on every update(), so a handler can get ready before its schedule turns on and free what it does not need while it is off.
+   * long long now: the current time. in milliseconds since the epoch.
+   * long long on: when the schedule turns on next. now if it is on, NO_DEADLINE if never.
+   * long long return: when to call update() next for this. NO_DEADLINE if there is no need.
    */
-  bool check_interval(tm *time){
-    int d_day = ((time->tm_wday - (&m_previous)->tm_wday) % 7 + 7) % 7;
-    int d_hour = ((time->tm_hour - (&m_previous)->tm_hour) % 24 + 24) % 24;
-    int d_min = ((time->tm_min - (&m_previous)->tm_min) % 60 + 60) % 60;
-    int d_sec = ((time->tm_sec - (&m_previous)->tm_sec) % 60 + 60 % 60);
-
-    m_counter += d_day * 86400000 + d_hour * 3600000 + d_min * 60000 + d_sec * 1000;
-    LOG("Word_Handler " << this << " >> counter: " << m_counter);
-
-    if(m_counter > m_next_counter){
-      m_counter = 0;
-      set_next_counter();
-      return true;
-    }
-
-    return false;
+  virtual long long prepare(long long /*now*/, long long /*on*/){
+    return NO_DEADLINE;
   }
 
   /**
-   * Uses the RNG to set the next counter.
+   * Uses the RNG to set when the next message is due.
+   * long long now: the current time. in milliseconds since the epoch.
    */
-  void set_next_counter(){
-    m_next_counter = m_interval_min + m_generator() % (m_interval_max - m_interval_min);
-    LOG("Word_Handler " << this << " >> set_next_counter(): " << m_next_counter);
+  void set_next_message(long long now){
+    m_next_message = now + m_interval_min + m_generator() % (m_interval_max - m_interval_min);
+    LOG("Message_Handler " << this << " >> set_next_message(): " << m_next_message - now);
   }
 };
 
@@ -138,73 +159,143 @@ public:
     m_message = message;
     m_interval_min = interval_min;
     m_interval_max = interval_max;
-    m_counter = 999999999;
-    time_t now = chrono::system_clock::to_time_t(chrono::system_clock::now());
-    m_previous = *localtime(&now);
-    set_next_counter();
+    m_next_message = 0;
     LOG("Word_Handler " << this << " >> new. Schedule: " << schedule << ", Message_Sender: " << ms);
   }
 
+  string get_name(){
+    return "WH_AUTO " + m_message.substr(0, m_message.find('\n'));
+  }
+
+protected:
   /**
-   * Takes tm of the current time. Will queue messages to its Message_Sender
-   * if necessary.
-   * tm *time: tm of the current time.
+   * Queues the message.
    */
-  void update(tm *time){
-    LOG("Word_Handler " << this << " >> update()");
-    if((*m_schedule).get_schedule(time->tm_wday, QUANTUM_NUMBER * time->tm_hour + time->tm_min / (60 / QUANTUM_NUMBER))){
-      if(check_interval(time)){
-        (*m_ms).queue_message(m_message);
-      }
-    }else{
-      m_counter = 99999999; // resets timer when schedule is over.
-    }
-
-    m_previous = *time;
+  bool queue_next(){
+    LOG("Word_Handler " << this << " >> queue_next()");
+    (*m_ms).queue_message(m_message);
+    return true;
   }
 };
 
+/**
+ * When a Markov_Generator learns its language.
+ */
+struct Load_Options{
+  bool lazy = false; // learns the language in the background shortly before the schedule turns on, instead of in the constructor.
+  long long lead = 300000; // how long before the schedule turns on to start learning. in milliseconds.
+  long long idle = 0; // with lazy, frees the language once the schedule was off for this long. in milliseconds. 0 never frees it.
+};
+
 /**
  * Message_Handler for generating text using Markov's chain.
  */
 class Markov_Generator : public Message_Handler{
 protected:
-  Language *language;
+  shared_ptr<const Language> language; // shared with every Markov_Generator that learns the same file. NULL while not loaded.
+  unique_ptr<Sentence_Pool> m_pool; // sentences generated ahead of time. NULL while not loaded.
+  shared_future<shared_ptr<const Language>> m_loading; // the language being learned in the background. not valid if none is. dropping it never waits.
+  string m_path; // the file the language was learned from.
+  bool m_is_dictionary; // reads the file as a dictionary file if true.
+  Language_Options m_options; // how to learn the file.
+  int m_pregenerate; // the number of sentences to generate ahead of time.
+  Load_Options m_load; // when to learn the file.
+  long long m_last_used; // the last time the schedule was on or about to turn on. in milliseconds since the epoch.
 
 public:
   /**
    * Constructor
+   * Language_Options options: how to learn the input file.
+   * int pregenerate: the number of sentences to generate ahead of time in the background. 0 to generate on update().
+   * Load_Options load: when to learn the input file. it is learned right away unless load.lazy is true.
    */
-  Markov_Generator(Schedule *schedule, Message_Sender *ms, bool is_dictionary, string input_file_path, int interval_min, int interval_max){
+  Markov_Generator(Schedule *schedule, Message_Sender *ms, bool is_dictionary, string input_file_path, int interval_min, int interval_max, Language_Options options, int pregenerate, Load_Options load){
     m_schedule = schedule;
     m_ms = ms;
-    language = new Language();
-    (*language).learn_file(input_file_path, is_dictionary);
+    m_path = input_file_path;
+    m_is_dictionary = is_dictionary;
+    m_options = options;
+    m_pregenerate = pregenerate;
+    m_load = load;
+    m_last_used = 0;
+    if(!m_load.lazy) set_language(Language_Registry::get(input_file_path, is_dictionary, options));
     m_interval_min = interval_min;
     m_interval_max = interval_max;
-    m_counter = 99999999;
-    time_t now = chrono::system_clock::to_time_t(chrono::system_clock::now());
-    m_previous = *localtime(&now);
-    set_next_counter();
-    LOG("Markov_Generator " << this << " >> new. Schedule: " << schedule << ", Message_Sender: " << ms);
+    m_next_message = 0;
+    LOG("Markov_Generator " << this << " >> new. Schedule: " << schedule << ", Message_Sender: " << ms << (m_load.lazy ? ", lazy." : ""));
+  }
+
+  string get_name(){
+    return "WH_MARKOV " + m_path;
   }
 
+protected:
   /**
-   * Takes tm of the current time. Will queue messages to its Message_Sender
-   * if necessary.
-   * tm *time: tm of the current time.
+   * Queues a generated sentence. Skips it if the language is still being learned.
    */
-  void update(tm *time){
-    LOG("Markov_Generator " << this << " >> update()");
-    if((*m_schedule).get_schedule(time->tm_wday, QUANTUM_NUMBER * time->tm_hour + time->tm_min / (60 / QUANTUM_NUMBER))){
-      if(check_interval(time)){
-        (*m_ms).queue_message((*language).generate_sentence());
-      }
-    }else{
-      m_counter = 99999999; // resets timer when schedule is over.
+  bool queue_next(){
+    LOG("Markov_Generator " << this << " >> queue_next()");
+    start_loading();
+    if(!finish_loading()){
+      LOG("Markov_Generator " << this << " >> queue_next(): " << m_path << " is not learned yet. skipped.");
+      return false;
+    }
+    (*m_ms).queue_message((*m_pool).pop());
+    return true;
+  }
+
+  /**
+   * With lazy loading, starts learning the language when the schedule turns on within the lead time,
+   * and frees it when the schedule was off for the idle time.
+   */
+  long long prepare(long long now, long long on){
+    if(!m_load.lazy) return NO_DEADLINE;
+    if(on != NO_DEADLINE && on - now <= m_load.lead){ // on, or about to turn on.
+      m_last_used = now;
+      start_loading();
+      return finish_loading() ? NO_DEADLINE : now + LOAD_POLL_INTERVAL;
     }
+    if(m_load.idle > 0 && (language || m_loading.valid())){
+      if(now - m_last_used < m_load.idle) return min(m_last_used + m_load.idle, get_load_time(on));
+      if(!finish_loading()) return min(now + LOAD_POLL_INTERVAL, get_load_time(on)); // a language can only be freed once it is learned.
+      LOG("Markov_Generator " << this << " >> prepare(): freeing " << m_path << ", idle since " << m_last_used);
+      m_pool.reset();
+      language.reset(); // the Language_Registry frees it if no other handler uses it.
+    }
+    return get_load_time(on);
+  }
+
+  /**
+   * Starts learning the language in the background if it is neither learned nor being learned.
+   */
+  void start_loading(){
+    if(language || m_loading.valid()) return;
+    LOG("Markov_Generator " << this << " >> start_loading(): " << m_path);
+    m_loading = Language_Registry::get_async(m_path, m_is_dictionary, m_options);
+  }
 
-    m_previous = *time;
+  /**
+   * Takes the language if it was learned in the background. Never waits.
+   * bool return: true if the language is learned.
+   */
+  bool finish_loading(){
+    if(language) return true;
+    if(!m_loading.valid() || m_loading.wait_for(chrono::seconds(0)) != future_status::ready) return false;
+    set_language(m_loading.get());
+    m_loading = shared_future<shared_ptr<const Language>>();
+    return true;
+  }
+
+  void set_language(shared_ptr<const Language> learned){
+    language = learned;
+    m_pool.reset(new Sentence_Pool(language, m_pregenerate, chrono::system_clock::now().time_since_epoch().count()));
+  }
+
+  /**
+   * Gets when to start learning the language for the next time the schedule turns on.
+   */
+  long long get_load_time(long long on){
+    return on == NO_DEADLINE ? NO_DEADLINE : on - m_load.lead;
   }
 };
 
@@ -0,0 +1,157 @@
+#include "LOG.hpp"
+
+#ifndef _H_MESSAGE_QUEUE
+#define _H_MESSAGE_QUEUE
+
+#include <vector>
+#include <atomic>
+#include <thread>
+#include <cstdint>
+#include <cstddef>
+#include <algorithm>
+
+using namespace std;
+
+/**
+ * What a Message_Queue does with a new item when it is full.
+ */
+enum Overflow_Policy{
+  DROP_OLDEST, // drops the oldest item to make room.
+  DROP_NEWEST, // drops the new item.
+  BLOCK // waits until the consumer takes an item. the consumer must run on another thread than the producers.
+};
+
+/**
+ * A bounded lock-free queue (Dmitry Vyukov's bounded MPMC queue) for many producers and one consumer.
+ * Every cell has a sequence number that tells whether it is free for the push or ready for the pop at a position,
+ * so push() and pop() only race on one compare-and-swap of the tail or head. Items are moved in and out.
+ * With DROP_OLDEST a full push() pops the oldest item itself, which the algorithm allows.
+ */
+template<typename T> class Message_Queue{
+  struct Cell{
+    atomic<size_t> sequence; // pos if the cell is free for the push at pos, pos + 1 if it holds the item of pos.
+    T data;
+  };
+
+  vector<Cell> m_cells; // the ring buffer. its size is a power of 2.
+  size_t m_mask; // m_cells.size() - 1.
+  Overflow_Policy m_policy; // what to do when full.
+  alignas(64) atomic<size_t> m_tail; // the next position to push to.
+  alignas(64) atomic<size_t> m_head; // the next position to pop from.
+
+public:
+  /**
+   * Constructor
+   * size_t capacity: the most items the queue holds. rounded up to a power of 2.
+   * Overflow_Policy policy: what to do when full.
+   */
+  Message_Queue(size_t capacity, Overflow_Policy policy) : m_cells(round_up(capacity)){
+    m_mask = m_cells.size() - 1;
+    m_policy = policy;
+    for(size_t i = 0; i < m_cells.size(); i++){
+      m_cells[i].sequence.store(i, memory_order_relaxed);
+    }
+    m_tail.store(0, memory_order_relaxed);
+    m_head.store(0, memory_order_relaxed);
+  }
+
+  Message_Queue(const Message_Queue&) = delete;
+  Message_Queue &operator=(const Message_Queue&) = delete;
+
+  /**
+   * Adds an item, following the overflow policy if the queue is full. Safe on any thread.
+   * T &&item: the item. moved from if it is added.
+   * bool return: false if an item was dropped.
+   */
+  bool push(T &&item){
+    if(try_push(item)) return true;
+    switch(m_policy){
+      case DROP_NEWEST:
+        return false;
+      case DROP_OLDEST:{
+        T oldest;
+        do{
+          try_pop(oldest);
+        }while(!try_push(item));
+        return false;
+      }
+      default:
+        while(!try_push(item)) this_thread::yield();
+        return true;
+    }
+  }
+
+  /**
+   * Takes the oldest item. Only the consumer may call this.
+   * T &item: set to the item.
+   * bool return: false if the queue is empty.
+   */
+  bool pop(T &item){
+    return try_pop(item);
+  }
+
+  /** returns true if the queue looks empty. it may change right after. */
+  bool empty() const {
+    size_t pos = m_head.load(memory_order_relaxed);
+    return m_cells[pos & m_mask].sequence.load(memory_order_acquire) != pos + 1;
+  }
+
+  /** get the number of items. it may change right after. */
+  size_t size() const {
+    size_t head = m_head.load(memory_order_relaxed);
+    size_t tail = m_tail.load(memory_order_relaxed);
+    return tail > head ? min(tail - head, m_cells.size()) : 0; // a push or pop in progress may already have moved them.
+  }
+
+  /** get the most items the queue holds */
+  size_t capacity() const {
+    return m_cells.size();
+  }
+
+private:
+  bool try_push(T &item){
+    size_t pos = m_tail.load(memory_order_relaxed);
+    Cell *cell;
+    while(true){
+      cell = &m_cells[pos & m_mask];
+      ptrdiff_t diff = (ptrdiff_t) cell->sequence.load(memory_order_acquire) - (ptrdiff_t) pos;
+      if(diff == 0){
+        if(m_tail.compare_exchange_weak(pos, pos + 1, memory_order_relaxed)) break;
+      }else if(diff < 0){
+        return false; // full.
+      }else{
+        pos = m_tail.load(memory_order_relaxed);
+      }
+    }
+    cell->data = move(item);
+    cell->sequence.store(pos + 1, memory_order_release);
+    return true;
+  }
+
+  bool try_pop(T &item){
+    size_t pos = m_head.load(memory_order_relaxed);
+    Cell *cell;
+    while(true){
+      cell = &m_cells[pos & m_mask];
+      ptrdiff_t diff = (ptrdiff_t) cell->sequence.load(memory_order_acquire) - (ptrdiff_t) (pos + 1);
+      if(diff == 0){
+        if(m_head.compare_exchange_weak(pos, pos + 1, memory_order_relaxed)) break;
+      }else if(diff < 0){
+        return false; // empty.
+      }else{
+        pos = m_head.load(memory_order_relaxed);
+      }
+    }
+    item = move(cell->data);
+    cell->sequence.store(pos + m_mask + 1, memory_order_release);
+    return true;
+  }
+
+  static size_t round_up(size_t capacity){
+    size_t size = 2;
+    while(size < capacity) size *= 2;
+    return size;
+  }
+};
+
+#endif
@@ -5,26 +5,103 @@
 
 #include <string>
 #include <iostream>
-#include <windows.h>
-#include <queue>
+#include <utility>
+#include <vector>
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#include "Message_Queue.cpp"
+#include "Token_Bucket.cpp"
+#include "Schedule.cpp"
+#include "Key_Backend.cpp"
+#include "Key_Layout.cpp"
+#include "Clipboard.cpp"
+#include "Window_Registry.cpp"
 
 using namespace std;
 
+/**
+ * How fast a Message_Sender may send, and when it tries again after it failed.
+ */
+struct Send_Limits{
+  int messages_per_minute = 0; // 0 means unlimited.
+  int characters_per_minute = 0; // 0 means unlimited. a pasted line counts every character of it.
+  int retry_interval = 10000; // the time before a sender that did not find its window tries again. in milliseconds.
+};
+
 /**
  * Interface for classes that send strings to a target window.
+ * queue_message() and is_saturated() may be called from any thread, the rest only from one thread at a time (the Send_Worker).
  */
 class Message_Sender {
 public:
+  virtual ~Message_Sender(){}
+
   /**
    * Will add the string to the message queue.
    * The contents of the queue will be sent at once when send() is called.
+   * string s: the string. pass a temporary or move it in to avoid a copy.
    */
   virtual void queue_message(string s) = 0;
 
   /**
    * Attempts to send queued strings to the target window.
+   * int budget: the most keystrokes to type. a message that does not fit is finished by the next call. 0 for no limit.
+   * bool return value: returns false if failed.
+   */
+  virtual bool send(int budget) = 0;
+
+  /** returns true if no message is queued */
+  virtual bool is_empty() = 0;
+
+  /**
+   * Finds how long until send() can send the queued messages, because of a rate limit or a failure before.
+   * long long return: in milliseconds. 0 if it can send now, NO_DEADLINE if no message is queued.
+   */
+  virtual long long get_wait() = 0;
+
+  /**
+   * Tells the handlers to stop queueing for now. Safe on any thread.
+   * bool return: true if the queue is full or the target window was not found the last time.
    */
-  virtual bool send() = 0;
+  virtual bool is_saturated() = 0;
+};
+
+/**
+ * A Message_Sender that drops every message. Used by the dry run instead of the windows.
+ */
+class MS_Stub : public Message_Sender {
+  string m_name; // the window the messages were meant for.
+
+public:
+  /**
+   * Constructor
+   */
+  MS_Stub(string name){
+    LOG("MS_Stub " << this << " >> new, Window: " << name);
+    m_name = name;
+  }
+
+  void queue_message(string s){
+    LOG("MS_Stub " << this << " >> queue_message(), Window: " << m_name << ", String: " << s);
+  }
+
+  bool send(int /*budget*/){
+    return true;
+  }
+
+  bool is_empty(){
+    return true;
+  }
+
+  long long get_wait(){
+    return NO_DEADLINE;
+  }
+
+  bool is_saturated(){
+    return false;
+  }
 };
 
 class MS_Window : public Message_Sender {
@@ -33,161 +110,307 @@ protected:
   string m_window_name; // the window name to send the input to. the window that contains this name will be selected.
   string m_return_window_name; // the window name to return to at the end of send().
   int m_max_windows; // the maximum number of windows that the activate_window() method will look through. This is to avoid infinite alt tabbing.
-  queue<string> m_message_queue; // message queue to send multiple messages in one alt tab operation.
+  Message_Queue<string> m_message_queue; // message queue to send multiple messages in one alt tab operation. lock-free, so handlers on any thread can queue.
+  string m_current; // the message being typed. empty if none.
+  size_t m_position; // the next character of m_current to type.
+  Key_Backend *m_keys; // emits the keystrokes. shared with other senders.
+  vector<Key_Event> m_events; // the keystrokes of the message being typed. reused between messages.
+  Clipboard *m_clipboard; // pastes the lines of the messages. NULL to type them.
+  Window_Registry *m_windows; // finds the windows. shared with other senders.
+  Token_Bucket m_message_rate; // limits the messages per minute.
+  Token_Bucket m_character_rate; // limits the characters per minute.
+  int m_retry_interval; // the time before trying again after the window was not found. in milliseconds.
+  long long m_retry_time; // when to try again. in milliseconds of the steady clock.
+  atomic<bool> m_reachable; // false if the window was not found the last time.
 
 
 public:
   /**
    * Constructor
+   * int queue_capacity: the most messages that can wait to be sent.
+   * Overflow_Policy overflow: what to do with a message when the queue is full.
+   * Key_Backend *keys: emits the keystrokes. it must outlive the sender.
+   * Clipboard *clipboard: pastes the messages instead of typing them. NULL to type them. it must outlive the sender.
+   * Window_Registry *windows: finds the windows. it must outlive the sender.
+   * Send_Limits limits: how fast to send.
    */
-  MS_Window(int delay, int maxW, string WName, string ret_WName){
+  MS_Window(int delay, int maxW, string WName, string ret_WName, int queue_capacity, Overflow_Policy overflow, Key_Backend *keys, Clipboard *clipboard, Window_Registry *windows, Send_Limits limits)
+    : m_message_queue(queue_capacity, overflow), m_message_rate(limits.messages_per_minute), m_character_rate(limits.characters_per_minute){
     LOG("MS_Window " << this << " >> new");
     m_input_delay = delay; // in milliseconds
     m_max_windows = maxW;
     m_window_name = WName;
     m_return_window_name = ret_WName;
+    m_position = 0;
+    m_keys = keys;
+    m_clipboard = clipboard;
+    m_windows = windows;
+    m_retry_interval = limits.retry_interval;
+    m_retry_time = 0;
+    m_reachable = true;
   }
 
   /**
    * Queues a string to be sent to the window in the next operation.
-   * string s: the string that is to be queued. (*WARNING*: read method send_string() for details.)
+   * string s: the UTF-8 string that is to be queued. (read method send_char() for what can be typed.)
    */
   void queue_message(string s){
     LOG("MS_Window " << this << " >> queue_message(), Window: " << m_window_name << ", String: " << s);
-    m_message_queue.push(s);
+    if(!m_message_queue.push(move(s))){
+      LOG("MS_Window " << this << " >> queue_message(): queue is full, a message was dropped. Window: " << m_window_name);
+    }
   }
 
   /**
    * Attempts to send strings that are queued as keyboard input to the window that contains "m_window_name"
    * in its title. Will attempt change the window to paycheck.exe after.
+   * int budget: the most keystrokes to type. 0 for no limit.
    * bool return value: returns false if failed. otherwise returns true
    */
-  bool send(){
-    if(m_message_queue.empty()) return true; // do nothing if queue is empty.
+  bool send(int budget){
+    if(is_empty()) return true; // do nothing if queue is empty.
     LOG("MS_Window " << this << " >> send(), Window: " << m_window_name);
+    bool ret = activate();
+    if(ret) type(budget); // if success.
+    set_reachable(ret);
+    return_home();
+    return ret;
+  }
+
+  /** returns true if no message is queued or half typed */
+  bool is_empty(){
+    return m_position >= m_current.size() && m_message_queue.empty();
+  }
+
+  long long get_wait(){
+    if(is_empty()) return NO_DEADLINE;
+    long long now = get_time();
+    long long wait = max(m_retry_time - now, 0LL);
+    if(m_position >= m_current.size()){ // a new message is next.
+      wait = max(wait, m_message_rate.get_wait(1, now));
+      return max(wait, m_character_rate.get_wait(1, now));
+    }
+    return max(wait, m_character_rate.get_wait(count_characters(m_position, m_current.size()), now)); // see type_messages().
+  }
+
+  bool is_saturated(){
+    return !m_reachable || m_message_queue.size() >= m_message_queue.capacity();
+  }
+
+  /** get the name of the window to send the input to */
+  string get_window_name(){
+    return m_window_name;
+  }
+
+  /**
+   * Brings the window to send the input to to the front.
+   * Call set_reachable() with the outcome of the send.
+   * bool return value: returns false if it was not found.
+   */
+  bool activate(){
     bool ret = activate_window(m_window_name);
-    if(ret){ // if success.
-      while(!m_message_queue.empty()){
-        Sleep(m_input_delay);
-        send_string(m_message_queue.front());
-        m_message_queue.pop();
+    if(!ret) LOG("MS_Window " << this << " >> activate() not found, Window: " << m_window_name);
+    return ret;
+  }
+
+  /**
+   * Brings the window to return to to the front.
+   */
+  void return_home(){
+    activate_window(m_return_window_name);
+  }
+
+  /**
+   * Records whether the window to send the input to was found, so a sender that failed waits before trying again.
+   * bool reachable: false if it was not found.
+   */
+  void set_reachable(bool reachable){
+    m_reachable = reachable;
+    if(!reachable) m_retry_time = get_time() + m_retry_interval;
+  }
+
+  /**
+   * Types queued messages into the window that has the focus.
+   * int budget: the most keystrokes to type. 0 for no limit.
+   */
+  void type(int budget){
+    type_messages(budget);
+    delay(m_input_delay);
+  }
+
+protected:
+
+  /**
+   * Pauses the thread that sends, so the window can follow the keys.
+   * int milliseconds: how long. 0 does not pause.
+   */
+  static void delay(int milliseconds){
+    if(milliseconds > 0) this_thread::sleep_for(chrono::milliseconds(milliseconds));
+  }
+
+  /** get the time of the steady clock. in milliseconds. */
+  static long long get_time(){
+    return chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+  }
+
+  /**
+   * Takes the oldest queued message.
+   * string &s: set to the message.
+   * bool return: false if no message is queued.
+   */
+  bool pop_message(string &s){
+    return m_message_queue.pop(s);
+  }
+
+  /**
+   * Types queued messages as keyboard input until the budget or a rate limit is used up.
+   * The keys of a message are handed to the Key_Backend at once, which paces them.
+   * With a clipboard every line is pasted and counts as one character of the budget.
+   * A message that does not fit is kept with its position and finished first by the next call.
+   * A message is only started or resumed once the character rate allows the rest of it, or a full bucket if it is longer,
+   * so a long message costs a few window switches instead of one per character the bucket refills.
+   * int budget: the most characters to type. 0 for every queued message.
+   */
+  void type_messages(int budget){
+    long long now = get_time();
+    size_t typed_end = 0; // the end of a line that could not be pasted. it is typed up to there.
+    if(m_position < m_current.size() && m_character_rate.get_wait(count_characters(m_position, m_current.size()), now) > 0) return;
+    for(int keys = 0; budget <= 0 || keys < budget; keys++){
+      while(m_position >= m_current.size()){
+        flush_keys();
+        if(m_message_rate.get_wait(1, now) > 0 || !pop_message(m_current)){
+          m_current.clear();
+          m_position = 0;
+          return;
+        }
+        m_message_rate.take(1, now);
+        m_position = 0;
+        typed_end = 0;
+        delay(m_input_delay);
+        if(m_character_rate.get_wait(count_characters(0, m_current.size()), now) > 0) return; // kept, get_wait() tells when it fits.
       }
-      Sleep(m_input_delay);
-    }else{
-      LOG("MS_Window " << this << " >> send() not found, Window: " << m_window_name);
+      if(m_clipboard != NULL && m_position >= typed_end){
+        size_t end = min(m_current.find('\n', m_position), m_current.size()); // the line break is typed.
+        if(end > m_position){
+          if(m_character_rate.get_wait(count_characters(m_position, end), now) > 0) break;
+          if(paste_line(end)){
+            m_character_rate.take(count_characters(m_position, end), now);
+            m_position = end;
+            continue;
+          }
+          typed_end = end;
+        }
+      }
+      if(!m_character_rate.take(1, now)) break;
+      m_position = send_char(m_current, m_position);
+    }
+    flush_keys();
+  }
+
+  /**
+   * Counts the characters of a part of the message being typed, as the character rate counts them.
+   * size_t begin: the first byte of the part.
+   * size_t end: the end of the part.
+   * size_t return: the number of UTF-8 characters.
+   */
+  size_t count_characters(size_t begin, size_t end){
+    size_t ret = 0;
+    for(size_t i = begin; i < end; i++){
+      if(((unsigned char) m_current[i] & 0xC0) != 0x80) ret++; // not a continuation byte.
     }
-    activate_window(m_return_window_name);
     return ret;
   }
 
-protected:
   /**
-   * Sends a string as keyboard input.
-   * *WARNING*: It's incomplete.
-   * string s: The string to be send as keyboard input. (Can only accpets a handful of inputs.)
+   * Pastes a part of the message being typed with Ctrl-V.
+   * size_t end: the end of the part. it starts at m_position.
+   * bool return: false if the clipboard could not be set. the rest of the line is typed instead.
+   */
+  bool paste_line(size_t end){
+    flush_keys();
+    if(!(*m_clipboard).set_text(m_current.substr(m_position, end - m_position))){
+      LOG("MS_Window " << this << " >> paste_line(): could not set the clipboard. typing instead. Window: " << m_window_name);
+      return false;
+    }
+    m_events.push_back(Key_Event{17, false});
+    m_events.push_back(Key_Event{86, false});
+    m_events.push_back(Key_Event{86, true});
+    m_events.push_back(Key_Event{17, true});
+    flush_keys();
+    delay(m_input_delay); // the window reads the clipboard when it gets to the keys. it must not change before.
+    return true;
+  }
+
+  /**
+   * Hands the collected keystrokes to the Key_Backend.
+   */
+  void flush_keys(){
+    if(m_events.empty()) return;
+    (*m_keys).send(m_events);
+    m_events.clear();
+  }
+
+  /**
+   * Adds the keystrokes of a character to the keys to send.
+   * Characters with a key in KEY_TABLE are typed with it, other characters are typed as unicode input.
+   * Control characters but the line break have no key and are skipped.
+   * const string &s: the UTF-8 string to type.
+   * size_t position: the first byte of the character.
+   * size_t return: the first byte of the next character.
    */
-  void send_string(string s){
-    for(unsigned int i = 0; i < s.length() + 1; i++){
-      if('a' <= s[i] && 'z' >= s[i]){
-        send_key(s[i] - 32, false);
-      }else if('A' <= s[i] && 'Z' >= s[i]){
-        send_key(s[i], true);
-      }else if(s[i] == '\n'){ // enter key.
-        send_key(13, false);
-      }else if(s[i] == '!'){
-        send_key(49, true);
-      }else if(s[i] == '@'){ // no mentioning
-        //send_key(50, true);
-      }else if(s[i] == '#'){
-        send_key(51, true);
-      }else if('$' == s[i]){
-        send_key(52, true);
-      }else if(s[i] == '%'){
-        send_key(53, true);
-      }else if(s[i] == '^'){
-        send_key(54, true);
-      }else if(s[i] == '&'){
-        send_key(55, true);
-      }else if(s[i] == '*'){
-        send_key(56, true);
-      }else if(s[i] == '('){
-        send_key(57, true);
-      }else if(s[i] == ')'){
-        send_key(48, true);
-      }else if('-' == s[i]){
-        send_key(109, false);
-      }else if('_' == s[i]){
-        send_key(109, true);
-      }else if('=' == s[i]){
-        send_key(110, false);
-      }else if('+' == s[i]){
-        send_key(110, true);
-      }else if('0' <= s[i] && '9' >= s[i]){
-        send_key(s[i], false);
-      }else if('`' == s[i]){
-        send_key(192, false);
-      }else if('~' == s[i]){
-        send_key(192, true);
-      }else if('[' == s[i]){
-        send_key(219, false);
-      }else if('{' == s[i]){
-        send_key(219, true);
-      }else if('\\' == s[i]){ // not working.
-        send_key(220, false);
-      }else if('|' == s[i]){
-        send_key(220, true);
-      }else if(']' == s[i]){
-        send_key(221, false);
-      }else if('}' == s[i]){
-        send_key(221, true);
-      }else if(';' == s[i]){
-        send_key(186, false);
-      }else if(':' == s[i]){
-        send_key(186, true);
-      }else if('\'' == s[i]){
-        send_key(222, false);
-      }else if('\"' == s[i]){
-        send_key(222, true);
-      }else if(',' == s[i]){
-        send_key(188, false);
-      }else if('<' == s[i]){
-        send_key(188, true);
-      }else if('.' == s[i]){
-        send_key(190, false);
-      }else if('>' == s[i]){
-        send_key(190, true);
-      }else if('/' == s[i]){
-        send_key(191, false);
-      }else if('?' == s[i]){
-        send_key(191, true);
-      }else if('\0' == s[i]){
-        // do nothing.
-      }else if(' ' == s[i]){
-        send_key(32, false);
-      }else{
-        LOG("MS_Window " << this << " >> send_string(): invalid character: " << s[i] <<". skipped.");
+  size_t send_char(const string &s, size_t position){
+    unsigned int point = decode_utf8(s, position);
+    if(point < 128){
+      const Key_Stroke &stroke = KEY_TABLE[point];
+      if(stroke.code != 0){
+        send_key(stroke.code, stroke.shift);
+      }else if(point != 0){
+        LOG("MS_Window " << this << " >> send_char(): invalid character: " << (int) point << ". skipped.");
       }
+    }else{
+      send_unicode(point);
+    }
+    return position;
+  }
 
-      Sleep(m_input_delay);
+  /**
+   * Adds a character to the keys to send as unicode input, which needs no key on the keyboard.
+   * unsigned int point: the code point.
+   */
+  void send_unicode(unsigned int point){
+    if(point >= 0x10000){ // a surrogate pair in UTF-16.
+      send_unicode(0xD800 + ((point - 0x10000) >> 10));
+      send_unicode(0xDC00 + ((point - 0x10000) & 0x3FF));
+      return;
     }
+    m_events.push_back(Key_Event{(unsigned short) point, false, true});
+    m_events.push_back(Key_Event{(unsigned short) point, true, true});
   }
 
   /**
-   * Sends a keypress.
+   * Adds a keypress to the keys to send.
    * unsigned char code: The code for the simulted keypress.
    * bool shift: Weather the key is pressed with the shift key or not.
    */
   void send_key(unsigned char code, bool shift){
-    if(shift){
-      keybd_event(160, 0x00, KEYEVENTF_EXTENDEDKEY | 0, 0);
-      keybd_event(code, 0x00, KEYEVENTF_EXTENDEDKEY | 0, 0);
-      Sleep(m_input_delay);
-      keybd_event(code, 0x00, KEYEVENTF_EXTENDEDKEY | KEYEVENTF_KEYUP, 0);
-      keybd_event(160, 0x00, KEYEVENTF_EXTENDEDKEY | KEYEVENTF_KEYUP, 0);
-    }else{
-      keybd_event(code, 0x00, KEYEVENTF_EXTENDEDKEY | 0, 0);
-      keybd_event(code, 0x00, KEYEVENTF_EXTENDEDKEY | KEYEVENTF_KEYUP, 0);
+    if(shift) m_events.push_back(Key_Event{160, false});
+    m_events.push_back(Key_Event{code, false});
+    m_events.push_back(Key_Event{code, true});
+    if(shift) m_events.push_back(Key_Event{160, true});
+  }
+
+  /**
+   * Presses tab a number of times while a modifier key is held down, pausing after every tab so the window can follow.
+   * unsigned char modifier: the code of the modifier key. 18 for alt, 17 for ctrl.
+   * int count: how many times to press tab.
+   */
+  void modifier_tab(unsigned char modifier, int count){
+    (*m_keys).send({Key_Event{modifier, false}});
+    for(int i = 0; i < count; i++){
+      (*m_keys).send({Key_Event{9, false}, Key_Event{9, true}});
+      delay(m_input_delay);
     }
+    (*m_keys).send({Key_Event{modifier, true}});
   }
 
   /**
@@ -195,14 +418,7 @@ protected:
    * int count: how many windows to tab through.
    */
   void alt_tab(int count){
-    keybd_event(18, 0x00, KEYEVENTF_EXTENDEDKEY | 0, 0);
-    for(int i = 0; i < count; i++){
-      keybd_event(9, 0x00, KEYEVENTF_EXTENDEDKEY | 0, 0);
-      Sleep(m_input_delay);
-      keybd_event(9, 0x00, KEYEVENTF_EXTENDEDKEY | KEYEVENTF_KEYUP, 0);
-      Sleep(m_input_delay);
-    }
-    keybd_event(18, 0x00, KEYEVENTF_EXTENDEDKEY | KEYEVENTF_KEYUP, 0);
+    modifier_tab(18, count);
   }
 
   /**
@@ -210,26 +426,25 @@ protected:
    * string return value: the name of the forground window. Will return a empty string if failed.
    */
   string get_foreground_window_name(){
-    char wnd_title[128];
-    HWND window = GetForegroundWindow();
-    int length = GetWindowText(window, wnd_title, sizeof(wnd_title));
-    if(length == 0) return "";
-    return wnd_title;
+    return (*m_windows).get_foreground_title();
   }
 
   /**
-   * Will attempt to alt tab to the window with the title that contains the given string.
+   * Will attempt to bring the window with the title that contains the given string to the front.
+   * The Window_Registry activates it directly. If that fails, for example because Windows refused to give it the focus,
+   * it is searched for by alt tabbing.
    * string windowTitle: the window you will search for.
    * bool return value: will return false if failed. otherwise will return true.
    */
   bool activate_window(string windowTitle){
+    if((*m_windows).activate(windowTitle)) return true;
     string firstWindow = get_foreground_window_name();
     string currentWindow = firstWindow.c_str();
     int tabCount = 1;
     while(currentWindow.find(windowTitle) == std::string::npos){
       alt_tab(tabCount);
       tabCount++;
-      Sleep(m_input_delay);
+      delay(m_input_delay);
       currentWindow = get_foreground_window_name();
       if(firstWindow == currentWindow) return false;
       if(tabCount >= m_max_windows) return false;
@@ -246,44 +461,64 @@ protected:
   string m_sub_window_name;
 
 public:
-  MS_Window_CT(int delay, int maxW, string WName, string ret_WName, string sub_window_name) : MS_Window(delay, maxW, WName, ret_WName){
+  MS_Window_CT(int delay, int maxW, string WName, string ret_WName, string sub_window_name, int queue_capacity, Overflow_Policy overflow, Key_Backend *keys, Clipboard *clipboard, Window_Registry *windows, Send_Limits limits)
+    : MS_Window(delay, maxW, WName, ret_WName, queue_capacity, overflow, keys, clipboard, windows, limits){
     LOG("MS_Window_CT " << this << " >> new");
     this->m_sub_window_name = sub_window_name;
   }
 
   /** Will send the queued messages to the desired window. */
-  bool send(){
-    if(m_message_queue.empty()) return true; // do nothing if queue is empty.
+  bool send(int budget){
+    if(is_empty()) return true; // do nothing if queue is empty.
     LOG("MS_Window_CT " << this << " >> send(), Window: " << m_window_name << ", Sub window: " << m_sub_window_name);
-    bool ret = activate_window(m_window_name);
+    bool ret = activate();
     if(ret) ret = activate_sub_window();
     if(ret){ // if success.
-      while(!m_message_queue.empty()){
-        Sleep(m_input_delay);
-        send_string(m_message_queue.front());
-        m_message_queue.pop();
-      }
-      Sleep(m_input_delay);
+      type(budget);
     }else{
       LOG("MS_Window_CT " << this << " >> send() not found, Window: " << m_window_name << ", Sub window: " << m_sub_window_name);
     }
-    activate_window(m_return_window_name);
+    set_reachable(ret);
+    return_home();
     return ret;
   }
+
+  /**
+   * Types the messages of several senders into the sub-windows of the window that has the focus.
+   * Goes around the sub-windows once with Ctrl-tab and types wherever the sub-window of a sender comes up,
+   * instead of searching from the start for every sender.
+   * const vector<MS_Window_CT*> &senders: senders of the window that has the focus.
+   * int budget: the most keystrokes to type per sender. 0 for no limit.
+   * vector<bool> &sent: set to false for every sender whose sub-window was not found.
+   */
+  static void send_sub_windows(const vector<MS_Window_CT*> &senders, int budget, vector<bool> &sent){
+    sent.assign(senders.size(), false);
+    if(senders.empty()) return;
+    MS_Window_CT &first = *senders[0]; // any sender can press the keys.
+    string firstWindow = first.get_foreground_window_name();
+    size_t left = senders.size();
+    for(int tabCount = 1; ; tabCount++){
+      string currentWindow = first.get_foreground_window_name();
+      for(size_t i = 0; i < senders.size(); i++){
+        if(!sent[i] && currentWindow.find((*senders[i]).m_sub_window_name) != std::string::npos){
+          (*senders[i]).type(budget);
+          sent[i] = true;
+          left--;
+        }
+      }
+      if(left == 0 || tabCount >= first.m_max_windows) return;
+      first.ctrl_tab(1);
+      delay(first.m_input_delay);
+      if(first.get_foreground_window_name() == firstWindow) return; // went around.
+    }
+  }
 protected:
   /**
    * Uses Ctrl-tab to navigate through sub windows.
    * int count: the number of times to Ctrl-tab.
    */
   void ctrl_tab(int count){
-    keybd_event(17, 0x00, KEYEVENTF_EXTENDEDKEY | 0, 0);
-    for(int i = 0; i < count; i++){
-      keybd_event(9, 0x00, KEYEVENTF_EXTENDEDKEY | 0, 0);
-      Sleep(m_input_delay);
-      keybd_event(9, 0x00, KEYEVENTF_EXTENDEDKEY | KEYEVENTF_KEYUP, 0);
-      Sleep(m_input_delay);
-    }
-    keybd_event(17, 0x00, KEYEVENTF_EXTENDEDKEY | KEYEVENTF_KEYUP, 0);
+    modifier_tab(17, count);
   }
 
   /**
@@ -296,7 +531,7 @@ protected:
     while(currentWindow.find(m_sub_window_name) == std::string::npos){
       ctrl_tab(1);
       tabCount++;
-      Sleep(m_input_delay);
+      delay(m_input_delay);
       currentWindow = get_foreground_window_name();
       if(firstWindow == currentWindow) return false;
       if(tabCount >= m_max_windows) return false;
@@ -0,0 +1,286 @@
+#include "LOG.hpp"
+
+#ifndef _H_MODEL_FILE
+#define _H_MODEL_FILE
+
+#include <string>
+#include <string_view>
+#include <fstream>
+#include <cstring>
+#include <cstdint>
+
+#include "Token_Table.cpp"
+#include "Context_Table.cpp"
+#include "Transition_Table.cpp"
+#include "Transition_Runs.cpp"
+
+#define MODEL_MAGIC "MCHATMDL"
+#define MODEL_VERSION 2
+
+using namespace std;
+
+/**
+ * The header at the start of a compiled model file.
+ * The sections follow in this order, each aligned to 8 bytes:
+ *   uint64_t token_offsets[token_count + 1], char token_chars[token_chars_size],
+ *   uint32_t contexts[state_count * MAX_ORDER], context_slots[context_slot_count], offsets[state_count + 1],
+ *   next[transition_count], next_count[transition_count], alias_prob[transition_count], alias[transition_count]
+ * Everything is stored in the byte order of the machine that wrote it (little endian on x86).
+ */
+struct Model_Header{
+  char magic[8]; // MODEL_MAGIC without the terminating zero.
+  uint32_t version; // MODEL_VERSION of the writer.
+  uint32_t order; // the order the model was learned with.
+  uint32_t max_order; // MAX_ORDER of the writer. the width of a context.
+  uint32_t token_count; // the number of words.
+  uint32_t state_count; // the number of states (contexts).
+  uint32_t context_slot_count; // the size of the context hash table.
+  uint32_t transition_count; // the number of successors.
+  uint32_t reserved; // always 0.
+  uint64_t token_chars_size; // the total size of every word in bytes.
+};
+
+/**
+ * Reads and writes compiled model files. A compiled model is the string table of a Token_Table, the contexts and
+ * hash table of a Context_Table and the compiled arrays of a Transition_Table, laid out so a memory mapped file
+ * can be used without parsing.
+ */
+class Model_File{
+  /** The byte positions of every section of a model file. */
+  struct Layout{
+    size_t token_offsets, token_chars, contexts, context_slots, offsets, next, next_count, alias_prob, alias, end;
+
+    Layout(const Model_Header &h){
+      token_offsets = align(sizeof(Model_Header));
+      token_chars = align(token_offsets + ((size_t) h.token_count + 1) * sizeof(uint64_t));
+      contexts = align(token_chars + h.token_chars_size);
+      context_slots = align(contexts + (size_t) h.state_count * MAX_ORDER * sizeof(uint32_t));
+      offsets = align(context_slots + (size_t) h.context_slot_count * sizeof(uint32_t));
+      next = align(offsets + ((size_t) h.state_count + 1) * sizeof(uint32_t));
+      next_count = align(next + (size_t) h.transition_count * sizeof(uint32_t));
+      alias_prob = align(next_count + (size_t) h.transition_count * sizeof(uint32_t));
+      alias = align(alias_prob + (size_t) h.transition_count * sizeof(uint32_t));
+      end = alias + (size_t) h.transition_count * sizeof(uint32_t);
+    }
+
+    static size_t align(size_t pos){
+      return (pos + 7) & ~(size_t) 7;
+    }
+  };
+
+public:
+  /**
+   * Checks if data starts like a compiled model file.
+   * string_view data: the contents of a file.
+   */
+  static bool is_model(string_view data){
+    return data.size() >= sizeof(Model_Header) && memcmp(data.data(), MODEL_MAGIC, 8) == 0;
+  }
+
+  /**
+   * Writes a compiled model file.
+   * const string &path: the file to write.
+   * int order: the order of the model.
+   * const Token_Table &tokens: the words of the model.
+   * const Context_Table &contexts: the contexts of the model.
+   * const Transition_Table &transitions: the transitions of the model. must be compiled.
+   * bool return: false if the file could not be written.
+   */
+  static bool write(const string &path, int order, const Token_Table &tokens, const Context_Table &contexts, const Transition_Table &transitions){
+    Model_Header header = make_header(order, tokens, contexts, transitions.size());
+    Layout layout(header);
+
+    ofstream out(path, ios::binary | ios::trunc);
+    if(!out.is_open()) return false;
+    write_states(out, header, layout, tokens, contexts);
+    pad(out, layout.offsets);
+    for(uint32_t s = 0; s <= header.state_count; s++){
+      write_u32(out, s < header.state_count ? transitions.successor_begin(s) : header.transition_count);
+    }
+    pad(out, layout.next);
+    for(uint32_t i = 0; i < header.transition_count; i++) write_u32(out, transitions.get_next(i));
+    pad(out, layout.next_count);
+    for(uint32_t i = 0; i < header.transition_count; i++) write_u32(out, transitions.get_next_count(i));
+    pad(out, layout.alias_prob);
+    for(uint32_t i = 0; i < header.transition_count; i++) write_u32(out, transitions.get_alias_prob(i));
+    pad(out, layout.alias);
+    for(uint32_t i = 0; i < header.transition_count; i++) write_u32(out, transitions.get_alias(i));
+    out.close();
+    return !out.fail();
+  }
+
+  /**
+   * Writes a compiled model file from a file of transitions sorted by Transition_Record::operator<, with every
+   * transition once (see Transition_Runs::finish()). The transitions are streamed from the file a few times,
+   * so only the words and contexts have to fit in memory.
+   * const string &path: the file to write.
+   * int order: the order of the model.
+   * const Token_Table &tokens: the words of the model. the first word must be TK_START.
+   * const string &sorted_path: the file of sorted transitions.
+   * bool return: false if the file could not be written.
+   */
+  static bool write_sorted(const string &path, int order, const Token_Table &tokens, const string &sorted_path){
+    // first pass: the contexts become states in the order they come in, after the TK_START context.
+    Context_Table contexts;
+    uint32_t start = 0;
+    contexts.intern(&start, 1);
+    vector<uint32_t> offsets(2, 0);
+    uint64_t transition_count = 0;
+    for_each_state(sorted_path, [&](const vector<Transition_Record> &state){
+      uint32_t s = contexts.intern(state[0].context, state[0].get_order());
+      offsets.resize(s + 2, 0);
+      offsets[s + 1] = state.size();
+      transition_count += state.size();
+    });
+    if(transition_count > UINT32_MAX){
+      LOG("Model_File >> write_sorted(): too many transitions.");
+      return false;
+    }
+    for(size_t s = 1; s < offsets.size(); s++) offsets[s] += offsets[s - 1];
+
+    Model_Header header = make_header(order, tokens, contexts, transition_count);
+    Layout layout(header);
+    ofstream out(path, ios::binary | ios::trunc);
+    if(!out.is_open()) return false;
+    write_states(out, header, layout, tokens, contexts);
+    pad(out, layout.offsets);
+    out.write((const char*) offsets.data(), offsets.size() * sizeof(uint32_t));
+
+    // one more pass per array, since the arrays follow each other in the file.
+    pad(out, layout.next);
+    for_each_state(sorted_path, [&](const vector<Transition_Record> &state){
+      for(const Transition_Record &r : state) write_u32(out, r.next);
+    });
+    pad(out, layout.next_count);
+    for_each_state(sorted_path, [&](const vector<Transition_Record> &state){
+      for(const Transition_Record &r : state) write_u32(out, r.count);
+    });
+    for(int pass = 0; pass < 2; pass++){
+      pad(out, pass == 0 ? layout.alias_prob : layout.alias);
+      uint32_t base = 0;
+      for_each_state(sorted_path, [&](const vector<Transition_Record> &state){
+        vector<uint32_t> counts, alias_prob(state.size()), alias(state.size());
+        for(const Transition_Record &r : state) counts.push_back(r.count);
+        Transition_Table::build_alias(counts.data(), counts.size(), base, alias_prob.data(), alias.data());
+        out.write((const char*) (pass == 0 ? alias_prob.data() : alias.data()), state.size() * sizeof(uint32_t));
+        base += state.size();
+      });
+    }
+    out.close();
+    return !out.fail();
+  }
+
+  /**
+   * Attaches the contents of a compiled model file. Nothing is copied, so data must outlive both tables.
+   * string_view data: the contents of a compiled model file. must be 8 byte aligned, like a memory mapping.
+   * int &order: set to the order of the model.
+   * Token_Table &tokens: set to the words of the model.
+   * Context_Table &contexts: set to the contexts of the model.
+   * Transition_Table &transitions: set to the transitions of the model.
+   * bool return: false if the data is not a valid model of this version. the tables are left as they were.
+   */
+  static bool attach(string_view data, int &order, Token_Table &tokens, Context_Table &contexts, Transition_Table &transitions){
+    if(!is_model(data)) return false;
+    Model_Header header;
+    memcpy(&header, data.data(), sizeof(header));
+    if(header.version != MODEL_VERSION){
+      LOG("Model_File >> attach(): version " << header.version << " is not supported. expected " << MODEL_VERSION << ".");
+      return false;
+    }
+    if(header.max_order != MAX_ORDER || header.order < 1 || header.order > MAX_ORDER){
+      LOG("Model_File >> attach(): order " << header.order << " of " << header.max_order << " is not supported.");
+      return false;
+    }
+    if(header.context_slot_count == 0 || (header.context_slot_count & (header.context_slot_count - 1)) != 0) return false;
+    Layout layout(header);
+    if(layout.end > data.size()){
+      LOG("Model_File >> attach(): the file is truncated.");
+      return false;
+    }
+
+    const char *base = data.data();
+    const uint64_t *token_offsets = (const uint64_t*) (base + layout.token_offsets);
+    if(token_offsets[header.token_count] != header.token_chars_size) return false;
+    order = header.order;
+    tokens.attach(header.token_count, token_offsets, base + layout.token_chars);
+    contexts.attach(header.state_count, (const uint32_t*) (base + layout.contexts), header.context_slot_count, (const uint32_t*) (base + layout.context_slots));
+    transitions.attach(header.state_count, header.transition_count,
+      (const uint32_t*) (base + layout.offsets), (const uint32_t*) (base + layout.next), (const uint32_t*) (base + layout.next_count),
+      (const uint32_t*) (base + layout.alias_prob), (const uint32_t*) (base + layout.alias));
+    return true;
+  }
+
+private:
+  /**
+   * Fills in the header of a model.
+   */
+  static Model_Header make_header(int order, const Token_Table &tokens, const Context_Table &contexts, uint64_t transition_count){
+    Model_Header header;
+    memcpy(header.magic, MODEL_MAGIC, 8);
+    header.version = MODEL_VERSION;
+    header.order = order;
+    header.max_order = MAX_ORDER;
+    header.token_count = tokens.size();
+    header.state_count = contexts.size();
+    header.context_slot_count = contexts.get_slot_count();
+    header.transition_count = transition_count;
+    header.reserved = 0;
+    header.token_chars_size = 0;
+    for(uint32_t id = 0; id < tokens.size(); id++){
+      header.token_chars_size += tokens.get_word(id).size();
+    }
+    return header;
+  }
+
+  /**
+   * Writes everything up to the successor arrays: the header, the string table and the contexts.
+   */
+  static void write_states(ofstream &out, const Model_Header &header, const Layout &layout, const Token_Table &tokens, const Context_Table &contexts){
+    out.write((const char*) &header, sizeof(header));
+    pad(out, layout.token_offsets);
+    uint64_t offset = 0;
+    for(uint32_t id = 0; id < tokens.size(); id++){
+      out.write((const char*) &offset, sizeof(offset));
+      offset += tokens.get_word(id).size();
+    }
+    out.write((const char*) &offset, sizeof(offset));
+    pad(out, layout.token_chars);
+    for(uint32_t id = 0; id < tokens.size(); id++){
+      out.write(tokens.get_word(id).data(), tokens.get_word(id).size());
+    }
+    pad(out, layout.contexts);
+    for(uint32_t s = 0; s < header.state_count; s++){
+      out.write((const char*) contexts.get_context(s), MAX_ORDER * sizeof(uint32_t));
+    }
+    pad(out, layout.context_slots);
+    for(uint32_t i = 0; i < header.context_slot_count; i++) write_u32(out, contexts.get_slot(i));
+  }
+
+  /**
+   * Reads a sorted transition file and calls a function with the transitions of every context in turn.
+   */
+  template<typename F> static void for_each_state(const string &sorted_path, F f){
+    Run_Reader reader(sorted_path);
+    vector<Transition_Record> state;
+    Transition_Record record;
+    while(reader.next(record)){
+      if(!state.empty() && !state[0].same_context(record)){
+        f(state);
+        state.clear();
+      }
+      state.push_back(record);
+    }
+    if(!state.empty()) f(state);
+  }
+
+  /** writes zeros up to a position. */
+  static void pad(ofstream &out, size_t pos){
+    while((size_t) out.tellp() < pos) out.put('\0');
+  }
+
+  static void write_u32(ofstream &out, uint32_t value){
+    out.write((const char*) &value, sizeof(value));
+  }
+};
+
+#endif
@@ -0,0 +1,175 @@
+#include "LOG.hpp"
+
+#ifndef _H_SCHEDULE
+#define _H_SCHEDULE
+
+#include <vector>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <algorithm>
+#include <climits>
+#include <ctime>
+
+#define QUANTUM_NUMBER 60 // an hour is divided into this number.
+#define WEEK_FRAMES (7 * 24 * QUANTUM_NUMBER) // the number of time frames in a week.
+#define NO_DEADLINE LLONG_MAX // a deadline that never comes.
+
+using namespace std;
+
+/**
+ * A data structure to take care of the weekly schedule.
+ * The schedule is a sorted list of disjoint [start, end) intervals of time frames, counted from Sunday 0:00,
+ * so it can tell when it turns on or off next with a binary search.
+ * Schedules are immutable once interned, and identical schedules are shared through intern().
+ */
+class Schedule{
+  vector<pair<int, int>> m_intervals; // the time frames when the Message_Handler will send messages. sorted, never touching.
+
+public:
+  /**
+   * Constructor. The schedule is off all week.
+   */
+  Schedule(){
+  }
+
+  /**
+   * Turns the schedule on for some time frames of a day.
+   * int week: 0 = Sun, 1 = Mon, ... , 6 = Sat
+   * int start: the first time frame. 0:00 - 0:00 + 60 / QUANTUM_NUMBER minutes = 0, ...
+   * int end: the time frame after the last one. must not be before start.
+   */
+  void add(int week, int start, int end){
+    check(week, start, end);
+    if(start == end) return;
+    start += week * 24 * QUANTUM_NUMBER;
+    end += week * 24 * QUANTUM_NUMBER;
+
+    // merge every interval that overlaps or touches [start, end).
+    auto first = lower_bound(m_intervals.begin(), m_intervals.end(), make_pair(start, INT_MIN),
+      [](const pair<int, int> &a, const pair<int, int> &b){ return a.second < b.first; });
+    auto last = first;
+    while(last != m_intervals.end() && (*last).first <= end){
+      start = min(start, (*last).first);
+      end = max(end, (*last).second);
+      last++;
+    }
+    first = m_intervals.erase(first, last);
+    m_intervals.insert(first, make_pair(start, end));
+  }
+
+  /**
+   * Gets schedule at a time.
+   * long long time: in milliseconds since the epoch.
+   * bool return value: the value of the schedule.
+   */
+  bool is_on(long long time) const {
+    long long frame_start;
+    return find(get_frame(time, frame_start)) >= 0;
+  }
+
+  /**
+   * Finds when the schedule turns on next.
+   * long long time: in milliseconds since the epoch.
+   * long long return value: time if the schedule is on, the start of the next interval otherwise. NO_DEADLINE if it is never on.
+   */
+  long long next_on(long long time) const {
+    if(m_intervals.empty()) return NO_DEADLINE;
+    long long frame_start;
+    int frame = get_frame(time, frame_start);
+    if(find(frame) >= 0) return time;
+    auto next = upper_bound(m_intervals.begin(), m_intervals.end(), make_pair(frame, INT_MAX));
+    int start = next != m_intervals.end() ? (*next).first : m_intervals[0].first + WEEK_FRAMES;
+    return frame_start + (start - frame) * (3600000LL / QUANTUM_NUMBER);
+  }
+
+  /**
+   * Finds when the schedule turns off next.
+   * long long time: in milliseconds since the epoch.
+   * long long return value: time if the schedule is off, the end of the current interval otherwise. NO_DEADLINE if it is always on.
+   */
+  long long next_off(long long time) const {
+    long long frame_start;
+    int frame = get_frame(time, frame_start);
+    int i = find(frame);
+    if(i < 0) return time;
+    if(m_intervals[0].first == 0 && m_intervals[0].second == WEEK_FRAMES) return NO_DEADLINE;
+    int end = m_intervals[i].second;
+    if(end == WEEK_FRAMES && m_intervals[0].first == 0) end += m_intervals[0].second; // goes on past Saturday midnight.
+    return frame_start + (end - frame) * (3600000LL / QUANTUM_NUMBER);
+  }
+
+  /**
+   * Finds when the schedule changes next, so a handler can sleep until then.
+   * long long time: in milliseconds since the epoch.
+   * long long return value: the next time the schedule turns on or off. NO_DEADLINE if it never changes.
+   */
+  long long next_change(long long time) const {
+    return is_on(time) ? next_off(time) : next_on(time);
+  }
+
+  /** get the number of intervals */
+  size_t size() const {
+    return m_intervals.size();
+  }
+
+  /**
+   * Gets the shared schedule that is equal to a schedule, adding it if there is none yet.
+   * Interned schedules live until the program ends.
+   * const Schedule &schedule: the schedule.
+   * Schedule *return: the shared schedule.
+   */
+  static Schedule *intern(const Schedule &schedule){
+    lock_guard<mutex> lock(get_mutex());
+    map<vector<pair<int, int>>, unique_ptr<Schedule>> &schedules = get_schedules();
+    unique_ptr<Schedule> &ret = schedules[schedule.m_intervals];
+    if(ret == NULL){
+      ret.reset(new Schedule(schedule));
+      LOG("Schedule " << ret.get() << " >> intern(): new. " << schedule.size() << " intervals.");
+    }
+    return ret.get();
+  }
+
+private:
+  /**
+   * Gets the interval that holds a time frame.
+   * int frame: the time frame.
+   * int return: the index of the interval. -1 if the schedule is off.
+   */
+  int find(int frame) const {
+    auto next = upper_bound(m_intervals.begin(), m_intervals.end(), make_pair(frame, INT_MAX));
+    if(next == m_intervals.begin() || (*(next - 1)).second <= frame) return -1;
+    return next - 1 - m_intervals.begin();
+  }
+
+  /**
+   * Gets the time frame of a time in the local time zone, counted from Sunday 0:00.
+   * long long time: in milliseconds since the epoch.
+   * long long &frame_start: set to the start of the time frame. in milliseconds since the epoch.
+   */
+  static int get_frame(long long time, long long &frame_start){
+    time_t time_c = time / 1000;
+    tm *local = localtime(&time_c); // the Windows CRT keeps the result per thread, so this is safe on any thread.
+    frame_start = time - time % 1000 - local->tm_sec * 1000LL - (local->tm_min % (60 / QUANTUM_NUMBER)) * 60000LL;
+    return local->tm_wday * 24 * QUANTUM_NUMBER + QUANTUM_NUMBER * local->tm_hour + local->tm_min / (60 / QUANTUM_NUMBER);
+  }
+
+  void check(int week, int start, int end){
+    if(week < 0 || 6 < week || start < 0 || end < start || 24 * QUANTUM_NUMBER < end){
+      LOG("Schedule " << this << " >> check(): argument was out of range. week: " << week << ", start: " << start << ", end: " << end);
+      exit(1);
+    }
+  }
+
+  static map<vector<pair<int, int>>, unique_ptr<Schedule>> &get_schedules(){
+    static map<vector<pair<int, int>>, unique_ptr<Schedule>> schedules;
+    return schedules;
+  }
+
+  static mutex &get_mutex(){
+    static mutex m;
+    return m;
+  }
+};
+
+#endif
@@ -0,0 +1,141 @@
+#include "LOG.hpp"
+
+#ifndef _H_SEND_PLANNER
+#define _H_SEND_PLANNER
+
+#include <string>
+#include <list>
+#include <vector>
+#include <chrono>
+
+#include "Message_Sender.cpp"
+
+using namespace std;
+
+/**
+ * What happened when the queue of a Message_Sender was sent.
+ */
+struct Send_Report{
+  Message_Sender *sender; // the sender.
+  bool sent; // false if the window was not found. the messages stay queued and are retried.
+  long long time; // when the sender was done. in milliseconds since the epoch.
+};
+
+/**
+ * Sends the queues of every Message_Sender in one round of focus switches.
+ * Senders are grouped by the window they type into, so every window is activated once per round however many
+ * senders it has. The sub-windows of a window are visited in one pass around its Ctrl-tab order
+ * (see MS_Window_CT::send_sub_windows()), and the return window is activated once at the end of the round.
+ */
+class Send_Planner{
+  /** The senders of one window. */
+  struct Window_Group{
+    string name; // the window name.
+    vector<MS_Window*> windows; // senders that type into the window as it is.
+    vector<MS_Window_CT*> sub_windows; // senders that type into a sub-window of it.
+  };
+
+  vector<Window_Group> m_groups; // in the order the windows first appear in the sender list.
+  vector<Message_Sender*> m_others; // senders that are not windows. they send on their own.
+
+public:
+  /**
+   * Constructor
+   * const list<Message_Sender*> &senders: the senders to send. they must outlive the planner.
+   */
+  Send_Planner(const list<Message_Sender*> &senders){
+    for(auto itr = senders.begin(); itr != senders.end(); itr++){
+      MS_Window *window = dynamic_cast<MS_Window*>(*itr);
+      if(window == NULL){
+        m_others.push_back(*itr);
+        continue;
+      }
+      Window_Group &group = get_group((*window).get_window_name());
+      MS_Window_CT *sub_window = dynamic_cast<MS_Window_CT*>(window);
+      if(sub_window != NULL){
+        group.sub_windows.push_back(sub_window);
+      }else{
+        group.windows.push_back(window);
+      }
+    }
+    LOG("Send_Planner " << this << " >> new. " << m_groups.size() << " windows, " << m_others.size() << " other senders.");
+  }
+
+  /**
+   * Sends one round: every sender that can send now, grouped by window.
+   * Senders that wait for a rate limit or to try again are left out.
+   * int budget: the most keystrokes to type per sender. 0 for no limit.
+   * vector<Send_Report> &reports: a report is added for every sender that sent.
+   * long long return: the time until the next round has something to send. in milliseconds. NO_DEADLINE if no message is queued.
+   */
+  long long send(int budget, vector<Send_Report> &reports){
+    MS_Window *home = NULL; // a sender that left the return window, to go back with.
+    for(Window_Group &group : m_groups){
+      vector<MS_Window*> windows;
+      vector<MS_Window_CT*> sub_windows;
+      for(MS_Window *window : group.windows){
+        if((*window).get_wait() == 0) windows.push_back(window);
+      }
+      for(MS_Window_CT *sub_window : group.sub_windows){
+        if((*sub_window).get_wait() == 0) sub_windows.push_back(sub_window);
+      }
+      if(windows.empty() && sub_windows.empty()) continue;
+
+      MS_Window &first = windows.empty() ? *sub_windows[0] : *windows[0];
+      home = &first;
+      LOG("Send_Planner " << this << " >> send(), Window: " << group.name << ", " << windows.size() + sub_windows.size() << " senders.");
+      bool found = first.activate();
+      vector<bool> sent;
+      if(found){
+        for(MS_Window *window : windows) (*window).type(budget);
+        MS_Window_CT::send_sub_windows(sub_windows, budget, sent);
+      }else{
+        sent.assign(sub_windows.size(), false);
+      }
+      for(MS_Window *window : windows){
+        (*window).set_reachable(found);
+        add_report(reports, window, found);
+      }
+      for(size_t i = 0; i < sub_windows.size(); i++){
+        (*sub_windows[i]).set_reachable(sent[i]);
+        add_report(reports, sub_windows[i], sent[i]);
+      }
+    }
+    if(home != NULL) (*home).return_home();
+
+    for(Message_Sender *other : m_others){
+      if((*other).get_wait() == 0) add_report(reports, other, (*other).send(budget));
+    }
+
+    long long wait = NO_DEADLINE;
+    for(Message_Sender *other : m_others) wait = min(wait, (*other).get_wait());
+    for(Window_Group &group : m_groups){
+      for(MS_Window *window : group.windows) wait = min(wait, (*window).get_wait());
+      for(MS_Window_CT *sub_window : group.sub_windows) wait = min(wait, (*sub_window).get_wait());
+    }
+    return wait;
+  }
+
+private:
+  /**
+   * Gets the group of a window, adding it if there is none.
+   */
+  Window_Group &get_group(const string &name){
+    for(Window_Group &group : m_groups){
+      if(group.name == name) return group;
+    }
+    m_groups.push_back(Window_Group());
+    m_groups.back().name = name;
+    return m_groups.back();
+  }
+
+  static void add_report(vector<Send_Report> &reports, Message_Sender *sender, bool sent){
+    Send_Report report;
+    report.sender = sender;
+    report.sent = sent;
+    report.time = chrono::duration_cast<chrono::milliseconds>(chrono::system_clock::now().time_since_epoch()).count();
+    reports.push_back(report);
+  }
+};
+
+#endif
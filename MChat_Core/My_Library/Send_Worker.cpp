@@ -0,0 +1,109 @@
+#include "LOG.hpp"
+
+#ifndef _H_SEND_WORKER
+#define _H_SEND_WORKER
+
+#include <list>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+
+#include "Message_Sender.cpp"
+#include "Message_Queue.cpp"
+#include "Send_Planner.cpp"
+
+using namespace std;
+
+/**
+ * Sends the queues of every Message_Sender on one background thread, so typing never blocks the main loop.
+ * There is only one worker because every sender has to take the keyboard focus, so two sends can never overlap anyway.
+ * The worker sends a round with a Send_Planner when notify() is called, and again whenever a sender that waited
+ * for a rate limit or to try again after a failure can send. Every send is reported through poll_report().
+ */
+class Send_Worker{
+  Send_Planner m_planner; // sends the senders.
+  Message_Queue<Send_Report> m_reports; // what happened, for the main loop.
+  bool m_pending; // true if notify() was called since the last round.
+  long long m_wait; // the time after the last round until the next one has something to send. in milliseconds.
+  bool m_stop; // tells the worker to finish.
+  mutex m_mutex; // guards m_pending and m_stop.
+  condition_variable m_wake; // signaled by notify() and on stop.
+  thread m_worker; // sends.
+
+public:
+  /**
+   * Constructor
+   * const list<Message_Sender*> &senders: the senders to send. they must outlive the worker.
+   */
+  Send_Worker(const list<Message_Sender*> &senders) : m_planner(senders), m_reports(256, DROP_OLDEST){
+    LOG("Send_Worker " << this << " >> new. senders: " << senders.size());
+    m_pending = false;
+    m_wait = NO_DEADLINE;
+    m_stop = false;
+    m_worker = thread(&Send_Worker::loop, this);
+  }
+
+  Send_Worker(const Send_Worker&) = delete;
+  Send_Worker &operator=(const Send_Worker&) = delete;
+
+  /** Destructor. Waits for the current round to finish. */
+  ~Send_Worker(){
+    {
+      lock_guard<mutex> lock(m_mutex);
+      m_stop = true;
+    }
+    m_wake.notify_all();
+    m_worker.join();
+  }
+
+  /**
+   * Tells the worker that messages were queued. Returns at once.
+   */
+  void notify(){
+    {
+      lock_guard<mutex> lock(m_mutex);
+      m_pending = true;
+    }
+    m_wake.notify_all();
+  }
+
+  /**
+   * Takes the oldest report. Only one thread may call this.
+   * Send_Report &report: set to the report.
+   * bool return: false if there is no report.
+   */
+  bool poll_report(Send_Report &report){
+    return m_reports.pop(report);
+  }
+
+private:
+  /**
+   * The body of the worker. Sends every sender that can send each time it is woken up or one of them can send again.
+   */
+  void loop(){
+    unique_lock<mutex> lock(m_mutex);
+    while(true){
+      if(m_wait != NO_DEADLINE){
+        m_wake.wait_for(lock, chrono::milliseconds(m_wait), [this]{ return m_stop || m_pending; });
+      }else{
+        m_wake.wait(lock, [this]{ return m_stop || m_pending; });
+      }
+      if(m_stop) return;
+      m_pending = false;
+      lock.unlock();
+
+      vector<Send_Report> reports;
+      long long wait = m_planner.send(0, reports);
+      for(Send_Report &report : reports){
+        m_reports.push(move(report));
+      }
+
+      lock.lock();
+      m_wait = wait;
+    }
+  }
+};
+
+#endif
@@ -0,0 +1,103 @@
+#include "LOG.hpp"
+
+#ifndef _H_SENTENCE_POOL
+#define _H_SENTENCE_POOL
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <random>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#include "Language.cpp"
+
+using namespace std;
+
+/**
+ * Keeps a ring buffer of sentences generated ahead of time by a background thread, so taking a sentence
+ * never waits for a random walk. Every pool has its own RNG that is seeded once.
+ * With a capacity of 0 there is no thread and pop() generates the sentence itself.
+ */
+class Sentence_Pool{
+  shared_ptr<const Language> m_language; // the language to generate from.
+  mt19937_64 m_generator; // RNG for the sentences. only used by the thread that generates.
+  vector<string> m_buffer; // the ring buffer.
+  size_t m_head; // index of the oldest sentence in m_buffer.
+  size_t m_size; // the number of sentences in m_buffer.
+  bool m_stop; // tells the worker to finish.
+  mutex m_mutex; // guards m_buffer, m_head, m_size and m_stop.
+  condition_variable m_changed; // signaled when a sentence is added or taken, or on stop.
+  thread m_worker; // refills m_buffer.
+
+public:
+  /**
+   * Constructor
+   * shared_ptr<const Language> language: the language to generate from.
+   * int capacity: the number of sentences to keep ready.
+   * unsigned seed: seed of the RNG.
+   */
+  Sentence_Pool(shared_ptr<const Language> language, int capacity, unsigned seed) : m_language(language), m_generator(seed){
+    LOG("Sentence_Pool " << this << " >> new. capacity: " << capacity);
+    m_buffer.resize(max(capacity, 0));
+    m_head = 0;
+    m_size = 0;
+    m_stop = false;
+    if(!m_buffer.empty()) m_worker = thread(&Sentence_Pool::fill, this);
+  }
+
+  Sentence_Pool(const Sentence_Pool&) = delete;
+  Sentence_Pool &operator=(const Sentence_Pool&) = delete;
+
+  /** Destructor */
+  ~Sentence_Pool(){
+    {
+      lock_guard<mutex> lock(m_mutex);
+      m_stop = true;
+    }
+    m_changed.notify_all();
+    if(m_worker.joinable()) m_worker.join();
+  }
+
+  /**
+   * Takes the oldest ready sentence. Only waits if the worker has not caught up yet.
+   * string return: the sentence.
+   */
+  string pop(){
+    if(m_buffer.empty()) return (*m_language).generate_sentence(m_generator);
+
+    unique_lock<mutex> lock(m_mutex);
+    m_changed.wait(lock, [this]{ return m_size > 0; });
+    string ret = move(m_buffer[m_head]);
+    m_head = (m_head + 1) % m_buffer.size();
+    m_size--;
+    lock.unlock();
+    m_changed.notify_all();
+    return ret;
+  }
+
+private:
+  /**
+   * Worker loop. Generates sentences until the buffer is full, then waits for one to be taken.
+   */
+  void fill(){
+    while(true){
+      {
+        unique_lock<mutex> lock(m_mutex);
+        m_changed.wait(lock, [this]{ return m_stop || m_size < m_buffer.size(); });
+        if(m_stop) return;
+      }
+      string sentence = (*m_language).generate_sentence(m_generator); // generated without holding the lock.
+      {
+        lock_guard<mutex> lock(m_mutex);
+        m_buffer[(m_head + m_size) % m_buffer.size()] = move(sentence);
+        m_size++;
+      }
+      m_changed.notify_all();
+    }
+  }
+};
+
+#endif
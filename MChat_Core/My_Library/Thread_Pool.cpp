@@ -0,0 +1,121 @@
+#include "LOG.hpp"
+
+#ifndef _H_THREAD_POOL
+#define _H_THREAD_POOL
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <cstdint>
+
+using namespace std;
+
+/**
+ * A fixed set of threads that run the iterations of a loop in parallel.
+ * The thread that calls run() works on the loop too, so a pool of 1 thread has no workers and runs everything itself.
+ */
+class Thread_Pool{
+  vector<thread> m_workers; // the threads besides the caller.
+  mutex m_mutex; // guards everything below but m_next.
+  condition_variable m_start; // signaled when a loop is started, or on stop.
+  condition_variable m_done; // signaled when the last worker finished a loop.
+  const function<void(size_t)> *m_task; // the body of the current loop.
+  size_t m_count; // the number of iterations of the current loop.
+  atomic<size_t> m_next; // the next iteration to run.
+  size_t m_running; // the number of workers still working on the current loop.
+  uint64_t m_generation; // the number of loops started so far.
+  bool m_stop; // tells the workers to finish.
+
+public:
+  /**
+   * Constructor
+   * int threads: the number of threads that run a loop, counting the caller.
+   */
+  Thread_Pool(int threads){
+    LOG("Thread_Pool " << this << " >> new. threads: " << threads);
+    m_task = NULL;
+    m_count = 0;
+    m_next = 0;
+    m_running = 0;
+    m_generation = 0;
+    m_stop = false;
+    for(int i = 1; i < threads; i++){
+      m_workers.push_back(thread(&Thread_Pool::loop, this));
+    }
+  }
+
+  Thread_Pool(const Thread_Pool&) = delete;
+  Thread_Pool &operator=(const Thread_Pool&) = delete;
+
+  /** Destructor */
+  ~Thread_Pool(){
+    {
+      lock_guard<mutex> lock(m_mutex);
+      m_stop = true;
+    }
+    m_start.notify_all();
+    for(thread &worker : m_workers) worker.join();
+  }
+
+  /**
+   * Runs task(i) for every i in [0, count) and returns when all of them are done.
+   * Every i runs once, on any thread. Only one thread may call run() at a time.
+   * size_t count: the number of iterations.
+   * const function<void(size_t)> &task: the body of the loop.
+   */
+  void run(size_t count, const function<void(size_t)> &task){
+    if(m_workers.empty() || count <= 1){
+      for(size_t i = 0; i < count; i++) task(i);
+      return;
+    }
+    {
+      lock_guard<mutex> lock(m_mutex);
+      m_task = &task;
+      m_count = count;
+      m_next = 0;
+      m_running = m_workers.size();
+      m_generation++;
+    }
+    m_start.notify_all();
+    work();
+    unique_lock<mutex> lock(m_mutex);
+    m_done.wait(lock, [this]{ return m_running == 0; });
+  }
+
+  /** get the number of threads that run a loop, counting the caller */
+  int size() const {
+    return m_workers.size() + 1;
+  }
+
+private:
+  /**
+   * Runs iterations of the current loop until none are left.
+   */
+  void work(){
+    size_t i;
+    while((i = m_next++) < m_count) (*m_task)(i);
+  }
+
+  /**
+   * The body of a worker. Waits for a loop, helps with it, and waits for the next one.
+   */
+  void loop(){
+    uint64_t seen = 0; // the last loop this worker worked on.
+    while(true){
+      {
+        unique_lock<mutex> lock(m_mutex);
+        m_start.wait(lock, [&]{ return m_stop || m_generation != seen; });
+        if(m_stop) return;
+        seen = m_generation;
+      }
+      work();
+      lock_guard<mutex> lock(m_mutex);
+      if(--m_running == 0) m_done.notify_all();
+    }
+  }
+};
+
+#endif
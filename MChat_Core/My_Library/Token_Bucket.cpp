@@ -0,0 +1,69 @@
+#include "LOG.hpp"
+
+#ifndef _H_TOKEN_BUCKET
+#define _H_TOKEN_BUCKET
+
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+
+/**
+ * A token bucket that limits how many things happen per minute.
+ * It fills up at the rate and holds a minute's worth of tokens, so bursts of up to a minute's worth are allowed.
+ * Taking more tokens than the bucket holds is allowed when it is full, and the debt is paid back before the next take.
+ * Not thread-safe.
+ */
+class Token_Bucket{
+  double m_rate; // tokens per millisecond. 0 for no limit.
+  double m_capacity; // the most tokens the bucket holds.
+  double m_tokens; // the tokens now. negative while in debt.
+  long long m_time; // when m_tokens was last brought up to date. in milliseconds.
+
+public:
+  /**
+   * Constructor. The bucket starts full.
+   * int per_minute: the rate. 0 or less for no limit.
+   */
+  Token_Bucket(int per_minute){
+    m_rate = per_minute > 0 ? per_minute / 60000.0 : 0;
+    m_capacity = max(per_minute, 1);
+    m_tokens = m_capacity;
+    m_time = 0;
+  }
+
+  /**
+   * Takes tokens if there are enough.
+   * double count: the number of tokens.
+   * long long now: the current time. in milliseconds.
+   * bool return: false if there were not enough. nothing is taken then.
+   */
+  bool take(double count, long long now){
+    if(m_rate == 0) return true;
+    refill(now);
+    if(m_tokens < min(count, m_capacity)) return false;
+    m_tokens -= count;
+    return true;
+  }
+
+  /**
+   * Finds how long until take() would succeed.
+   * double count: the number of tokens.
+   * long long now: the current time. in milliseconds.
+   * long long return: in milliseconds. 0 if there are enough now.
+   */
+  long long get_wait(double count, long long now){
+    if(m_rate == 0) return 0;
+    refill(now);
+    double missing = min(count, m_capacity) - m_tokens;
+    return missing <= 0 ? 0 : (long long) ceil(missing / m_rate);
+  }
+
+private:
+  void refill(long long now){
+    if(m_time != 0 && now > m_time) m_tokens = min(m_capacity, m_tokens + (now - m_time) * m_rate);
+    m_time = max(m_time, now);
+  }
+};
+
+#endif
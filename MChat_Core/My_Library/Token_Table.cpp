@@ -0,0 +1,128 @@
+#include "LOG.hpp"
+
+#ifndef _H_TOKEN_TABLE
+#define _H_TOKEN_TABLE
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+
+using namespace std;
+
+/**
+ * Interns the words of a language. Every distinct word gets a uint32_t id, handed out in the order
+ * the words are first seen, so the rest of the model only ever deals with ids.
+ * The table can also be attached to a string table in a compiled model file, in which case the words are
+ * read straight from the file until a new word has to be interned.
+ */
+class Token_Table{
+  vector<string> m_words; // the interned words. indexed by id.
+  vector<uint32_t> m_slots; // open-addressed hash table of ids. holds id + 1, 0 means the slot is empty.
+
+  bool m_attached; // true if the words are read from an attached string table.
+  uint32_t m_attached_count; // the number of words in the attached string table.
+  const uint64_t *m_attached_offsets; // word i of the attached string table is [offsets[i], offsets[i + 1]) in m_attached_chars.
+  const char *m_attached_chars; // the characters of the attached string table.
+
+public:
+  /** Constructor */
+  Token_Table(){
+    m_slots.assign(64, 0);
+    m_attached = false;
+  }
+
+  /**
+   * Reads the words from a string table instead. The string table must outlive this object or the next intern().
+   * uint32_t count: the number of words.
+   * const uint64_t *offsets: count + 1 offsets into chars. word i is [offsets[i], offsets[i + 1]).
+   * const char *chars: the characters of the words.
+   */
+  void attach(uint32_t count, const uint64_t *offsets, const char *chars){
+    m_words.clear();
+    m_slots.clear();
+    m_attached = true;
+    m_attached_count = count;
+    m_attached_offsets = offsets;
+    m_attached_chars = chars;
+  }
+
+  /**
+   * Returns the id of a word, adding it to the table if it is new.
+   * string_view word: the word. it is only copied if it is new.
+   * uint32_t return: the id of the word.
+   */
+  uint32_t intern(string_view word){
+    if(m_attached) detach();
+    size_t slot = find_slot(word);
+    if(m_slots[slot] != 0) return m_slots[slot] - 1;
+
+    m_words.push_back(string(word));
+    m_slots[slot] = m_words.size();
+    if(m_words.size() * 2 > m_slots.size()) grow();
+    return m_words.size() - 1;
+  }
+
+  /** get the word of an id */
+  string_view get_word(uint32_t id) const {
+    if(m_attached) return string_view(m_attached_chars + m_attached_offsets[id], m_attached_offsets[id + 1] - m_attached_offsets[id]);
+    return m_words[id];
+  }
+
+  /** get the number of distinct words */
+  uint32_t size() const {
+    return m_attached ? m_attached_count : m_words.size();
+  }
+
+private:
+  /**
+   * Copies the attached string table so new words can be added.
+   */
+  void detach(){
+    LOG("Token_Table " << this << " >> detach(): copying " << m_attached_count << " words.");
+    for(uint32_t id = 0; id < m_attached_count; id++){
+      m_words.push_back(string(get_word(id)));
+    }
+    m_attached = false;
+    m_slots.assign(64, 0);
+    while(m_words.size() * 2 > m_slots.size()) m_slots.resize(m_slots.size() * 2);
+    grow();
+  }
+
+  /**
+   * Finds the slot holding a word, or the empty slot the word would go into.
+   */
+  size_t find_slot(string_view word) const {
+    size_t mask = m_slots.size() - 1;
+    size_t slot = hash_word(word) & mask;
+    while(m_slots[slot] != 0 && m_words[m_slots[slot] - 1] != word){
+      slot = (slot + 1) & mask;
+    }
+    return slot;
+  }
+
+  /**
+   * Doubles the hash table and re-inserts every id.
+   */
+  void grow(){
+    m_slots.assign(m_slots.size() * 2, 0);
+    size_t mask = m_slots.size() - 1;
+    for(uint32_t id = 0; id < m_words.size(); id++){
+      size_t slot = hash_word(m_words[id]) & mask;
+      while(m_slots[slot] != 0) slot = (slot + 1) & mask;
+      m_slots[slot] = id + 1;
+    }
+  }
+
+  /** FNV-1a */
+  static uint64_t hash_word(string_view word){
+    uint64_t h = 14695981039346656037ULL;
+    for(unsigned char c : word){
+      h ^= c;
+      h *= 1099511628211ULL;
+    }
+    return h;
+  }
+};
+
+#endif
@@ -0,0 +1,56 @@
+#include "LOG.hpp"
+
+#ifndef _H_TOKENIZER
+#define _H_TOKENIZER
+
+#include <string>
+#include <string_view>
+
+#define DEFAULT_DELIMITERS " \t\r"
+
+using namespace std;
+
+/**
+ * Splits text into tokens in place. Tokens are views into the text, so nothing is copied.
+ * Any run of delimiter characters separates two tokens.
+ */
+class Tokenizer{
+  bool m_delimiter[256]; // true for every delimiter character.
+
+public:
+  /**
+   * Constructor
+   * const string &delimiters: every character that separates tokens.
+   */
+  Tokenizer(const string &delimiters = DEFAULT_DELIMITERS){
+    for(int i = 0; i < 256; i++){
+      m_delimiter[i] = false;
+    }
+    for(unsigned char c : delimiters){
+      m_delimiter[c] = true;
+    }
+  }
+
+  /**
+   * Takes the next token off the front of a text.
+   * string_view &text: the remaining text. the token and the delimiters before it are removed.
+   * string_view &token: set to the token.
+   * bool return: false if there are no tokens left.
+   */
+  bool next(string_view &text, string_view &token) const {
+    size_t begin = 0;
+    while(begin < text.size() && is_delimiter(text[begin])) begin++;
+    size_t end = begin;
+    while(end < text.size() && !is_delimiter(text[end])) end++;
+    token = text.substr(begin, end - begin);
+    text.remove_prefix(end);
+    return !token.empty();
+  }
+
+  /** returns true if a character is a delimiter */
+  bool is_delimiter(char c) const {
+    return m_delimiter[(unsigned char) c];
+  }
+};
+
+#endif
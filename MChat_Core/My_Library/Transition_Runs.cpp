@@ -0,0 +1,272 @@
+#include "LOG.hpp"
+
+#ifndef _H_TRANSITION_RUNS
+#define _H_TRANSITION_RUNS
+
+#include <string>
+#include <vector>
+#include <queue>
+#include <fstream>
+#include <algorithm>
+#include <cstdint>
+#include <windows.h>
+
+#include "Context_Table.cpp"
+
+#define MERGE_FAN_IN 64 // the most runs that are merged at once.
+
+using namespace std;
+
+/**
+ * One counted transition with its whole context, so it means the same thing outside of a Context_Table.
+ */
+struct Transition_Record{
+  uint32_t context[MAX_ORDER]; // the ids of the context, oldest first, padded with NO_TOKEN.
+  uint32_t next; // the id of the word that came after the context.
+  uint32_t count; // how many times it came after the context.
+
+  /** get the number of ids in the context */
+  int get_order() const {
+    int order = 0;
+    while(order < MAX_ORDER && context[order] != NO_TOKEN) order++;
+    return order;
+  }
+
+  /** returns true if both records have the same context */
+  bool same_context(const Transition_Record &other) const {
+    for(int i = 0; i < MAX_ORDER; i++){
+      if(context[i] != other.context[i]) return false;
+    }
+    return true;
+  }
+
+  /** returns true if both records count the same transition */
+  bool same_key(const Transition_Record &other) const {
+    return next == other.next && same_context(other);
+  }
+
+  /** sorts by order, then context, then next word. */
+  bool operator<(const Transition_Record &other) const {
+    int order = get_order(), other_order = other.get_order();
+    if(order != other_order) return order < other_order;
+    for(int i = 0; i < MAX_ORDER; i++){
+      if(context[i] != other.context[i]) return context[i] < other.context[i];
+    }
+    return next < other.next;
+  }
+};
+
+/**
+ * Interface for classes that take counted transitions instead of a Transition_Table, while a Language learns.
+ */
+class Transition_Sink{
+public:
+  virtual ~Transition_Sink(){}
+
+  /**
+   * Counts a transition.
+   * const uint32_t *context: the ids of the context, oldest first.
+   * int order: the number of ids in the context.
+   * uint32_t next: the id of the word that came after the context.
+   * uint32_t count: the amount to add.
+   */
+  virtual void add(const uint32_t *context, int order, uint32_t next, uint32_t count) = 0;
+};
+
+/**
+ * Reads a file of Transition_Record in order, a block at a time.
+ */
+class Run_Reader{
+  ifstream m_in; // the file.
+  vector<Transition_Record> m_buffer; // the current block.
+  size_t m_pos; // the next record in m_buffer.
+  size_t m_size; // the number of records in m_buffer.
+
+public:
+  /**
+   * Constructor
+   * const string &path: the file to read.
+   * size_t block: the number of records to read at a time.
+   */
+  Run_Reader(const string &path, size_t block = 4096) : m_in(path, ios::binary){
+    m_buffer.resize(max(block, (size_t) 1));
+    m_pos = 0;
+    m_size = 0;
+  }
+
+  /**
+   * Reads the next record.
+   * Transition_Record &record: set to the record.
+   * bool return: false at the end of the file.
+   */
+  bool next(Transition_Record &record){
+    if(m_pos == m_size){
+      m_in.read((char*) m_buffer.data(), m_buffer.size() * sizeof(Transition_Record));
+      m_size = m_in.gcount() / sizeof(Transition_Record);
+      m_pos = 0;
+      if(m_size == 0) return false;
+    }
+    record = m_buffer[m_pos++];
+    return true;
+  }
+};
+
+/**
+ * Counts transitions within a memory budget by spilling sorted runs to temporary files.
+ * finish() k-way merges the runs into one sorted file where every transition is counted once.
+ */
+class Transition_Runs : public Transition_Sink{
+  vector<Transition_Record> m_buffer; // transitions that were not spilled yet.
+  size_t m_capacity; // the number of records that fit in the budget.
+  vector<string> m_runs; // the spilled run files.
+  string m_merged; // the merged file. empty until finish().
+
+public:
+  /**
+   * Constructor
+   * size_t memory_budget: the memory for buffered transitions, in bytes.
+   */
+  Transition_Runs(size_t memory_budget){
+    m_capacity = max(memory_budget / sizeof(Transition_Record), (size_t) 1024);
+    m_buffer.reserve(m_capacity);
+    LOG("Transition_Runs " << this << " >> new. " << m_capacity << " records per run.");
+  }
+
+  Transition_Runs(const Transition_Runs&) = delete;
+  Transition_Runs &operator=(const Transition_Runs&) = delete;
+
+  /** Destructor. Deletes every temporary file. */
+  ~Transition_Runs(){
+    for(string &run : m_runs) DeleteFileA(run.c_str());
+    if(!m_merged.empty()) DeleteFileA(m_merged.c_str());
+  }
+
+  void add(const uint32_t *context, int order, uint32_t next, uint32_t count){
+    Transition_Record record;
+    for(int i = 0; i < MAX_ORDER; i++){
+      record.context[i] = i < order ? context[i] : NO_TOKEN;
+    }
+    record.next = next;
+    record.count = count;
+    m_buffer.push_back(record);
+    if(m_buffer.size() >= m_capacity) spill();
+  }
+
+  /**
+   * Merges every run into one file, sorted by Transition_Record::operator< with every transition once.
+   * At most MERGE_FAN_IN runs are merged at a time, so the read buffers stay within the budget.
+   * string return: the path of the merged file. it is deleted with this object.
+   */
+  string finish(){
+    spill();
+    vector<Transition_Record>().swap(m_buffer); // the merge buffers use the budget now.
+    while(m_runs.size() > MERGE_FAN_IN){
+      vector<string> runs(m_runs.begin(), m_runs.begin() + MERGE_FAN_IN);
+      m_runs.erase(m_runs.begin(), m_runs.begin() + MERGE_FAN_IN);
+      m_runs.push_back(make_temp_path());
+      merge(runs, m_runs.back());
+    }
+    m_merged = make_temp_path();
+    vector<string> runs;
+    runs.swap(m_runs);
+    uint64_t count = merge(runs, m_merged);
+    LOG("Transition_Runs " << this << " >> finish(): " << count << " transitions.");
+    return m_merged;
+  }
+
+  /**
+   * Makes an empty temporary file.
+   * string return: the path of the file.
+   */
+  static string make_temp_path(){
+    char dir[MAX_PATH];
+    char path[MAX_PATH];
+    if(GetTempPathA(MAX_PATH, dir) == 0 || GetTempFileNameA(dir, "mch", 0, path) == 0){
+      LOG("Transition_Runs >> make_temp_path(): could not make a temporary file. Closing program...");
+      exit(1);
+    }
+    return path;
+  }
+
+private:
+  /**
+   * K-way merges sorted runs into one file, adding up repeated transitions. The runs are deleted.
+   * const vector<string> &runs: the run files.
+   * const string &path: the file to write.
+   * uint64_t return: the number of transitions written.
+   */
+  uint64_t merge(const vector<string> &runs, const string &path){
+    ofstream out(path, ios::binary | ios::trunc);
+    size_t block = m_capacity / max(runs.size(), (size_t) 1); // the buffer shares the budget between the readers.
+    vector<Run_Reader*> readers;
+    auto later = [](const pair<Transition_Record, size_t> &a, const pair<Transition_Record, size_t> &b){ return b.first < a.first; };
+    priority_queue<pair<Transition_Record, size_t>, vector<pair<Transition_Record, size_t>>, decltype(later)> heap(later);
+    for(size_t i = 0; i < runs.size(); i++){
+      readers.push_back(new Run_Reader(runs[i], block));
+      Transition_Record record;
+      if((*readers[i]).next(record)) heap.push(make_pair(record, i));
+    }
+
+    Transition_Record current;
+    bool has_current = false;
+    uint64_t count = 0;
+    while(!heap.empty()){
+      pair<Transition_Record, size_t> top = heap.top();
+      heap.pop();
+      if(has_current && current.same_key(top.first)){
+        current.count += top.first.count;
+      }else{
+        if(has_current){
+          out.write((const char*) &current, sizeof(current));
+          count++;
+        }
+        current = top.first;
+        has_current = true;
+      }
+      Transition_Record record;
+      if((*readers[top.second]).next(record)) heap.push(make_pair(record, top.second));
+    }
+    if(has_current){
+      out.write((const char*) &current, sizeof(current));
+      count++;
+    }
+    if(out.fail()){
+      LOG("Transition_Runs " << this << " >> merge(): could not write " << path << ". Closing program...");
+      exit(1);
+    }
+
+    for(size_t i = 0; i < readers.size(); i++){
+      delete readers[i];
+      DeleteFileA(runs[i].c_str());
+    }
+    return count;
+  }
+
+  /**
+   * Sorts the buffered transitions, adds up repeated ones and writes them as a new run.
+   */
+  void spill(){
+    if(m_buffer.empty()) return;
+    sort(m_buffer.begin(), m_buffer.end());
+    size_t size = 0;
+    for(size_t i = 0; i < m_buffer.size(); i++){
+      if(size > 0 && m_buffer[size - 1].same_key(m_buffer[i])){
+        m_buffer[size - 1].count += m_buffer[i].count;
+      }else{
+        m_buffer[size++] = m_buffer[i];
+      }
+    }
+
+    m_runs.push_back(make_temp_path());
+    ofstream out(m_runs.back(), ios::binary | ios::trunc);
+    out.write((const char*) m_buffer.data(), size * sizeof(Transition_Record));
+    if(out.fail()){
+      LOG("Transition_Runs " << this << " >> spill(): could not write " << m_runs.back() << ". Closing program...");
+      exit(1);
+    }
+    LOG("Transition_Runs " << this << " >> spill(): run " << m_runs.size() << ", " << size << " transitions.");
+    m_buffer.clear();
+  }
+};
+
+#endif
@@ -0,0 +1,137 @@
+#include "LOG.hpp"
+
+#ifndef _H_TRANSITION_SKETCH
+#define _H_TRANSITION_SKETCH
+
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <cstdint>
+
+#include "Transition_Runs.cpp"
+
+#define SKETCH_DEPTH 4 // the number of rows in the count-min sketch.
+
+using namespace std;
+
+/**
+ * Counts transitions approximately within a memory budget.
+ * Every transition goes into a count-min sketch. Only the frequent ones (heavy hitters) are tracked by key,
+ * and when the tracked table is full the rarer half is pruned. A transition whose sketch estimate is below
+ * what was pruned so far is not tracked at all, so the model ends up with the most frequent transitions only.
+ */
+class Transition_Sketch : public Transition_Sink{
+  struct Record_Hash{
+    size_t operator()(const Transition_Record &r) const {
+      return hash_record(r, 0);
+    }
+  };
+  struct Record_Equal{
+    bool operator()(const Transition_Record &a, const Transition_Record &b) const {
+      return a.same_key(b);
+    }
+  };
+
+  vector<uint32_t> m_sketch; // SKETCH_DEPTH rows of m_width counters.
+  size_t m_width; // the number of counters in a row.
+  unordered_map<Transition_Record, uint32_t, Record_Hash, Record_Equal> m_tracked; // the heavy hitters and their counts.
+  size_t m_capacity; // the number of heavy hitters that fit in the budget.
+  uint32_t m_admit; // the lowest estimate a transition needs to be tracked.
+  uint64_t m_pruned; // the number of tracked transitions that were pruned.
+
+public:
+  /**
+   * Constructor
+   * size_t memory_budget: the memory for the sketch and the tracked transitions, in bytes.
+   *   a quarter goes to the sketch, the rest to the tracked transitions.
+   */
+  Transition_Sketch(size_t memory_budget){
+    m_width = max(memory_budget / 4 / (SKETCH_DEPTH * sizeof(uint32_t)), (size_t) 1024);
+    m_sketch.assign(SKETCH_DEPTH * m_width, 0);
+    m_capacity = max(memory_budget / 4 * 3 / 64, (size_t) 1024); // about 64 bytes per tracked transition.
+    m_tracked.reserve(m_capacity);
+    m_admit = 0;
+    m_pruned = 0;
+    LOG("Transition_Sketch " << this << " >> new. width: " << m_width << ", capacity: " << m_capacity);
+  }
+
+  void add(const uint32_t *context, int order, uint32_t next, uint32_t count){
+    Transition_Record record;
+    for(int i = 0; i < MAX_ORDER; i++){
+      record.context[i] = i < order ? context[i] : NO_TOKEN;
+    }
+    record.next = next;
+    record.count = 0;
+
+    uint32_t estimate = UINT32_MAX;
+    for(int row = 0; row < SKETCH_DEPTH; row++){
+      uint32_t &counter = m_sketch[row * m_width + hash_record(record, row + 1) % m_width];
+      counter += count;
+      estimate = min(estimate, counter);
+    }
+
+    auto it = m_tracked.find(record);
+    if(it != m_tracked.end()){
+      (*it).second += count;
+      return;
+    }
+    if(estimate < m_admit) return; // too rare to track.
+    if(m_tracked.size() >= m_capacity) prune();
+    m_tracked.emplace(record, estimate);
+  }
+
+  /**
+   * Gets the tracked transitions, sorted by Transition_Record::operator<.
+   * vector<Transition_Record> return: the transitions with their counts.
+   */
+  vector<Transition_Record> get_records() const {
+    vector<Transition_Record> ret;
+    ret.reserve(m_tracked.size());
+    for(auto &entry : m_tracked){
+      ret.push_back(entry.first);
+      ret.back().count = entry.second;
+    }
+    sort(ret.begin(), ret.end());
+    LOG("Transition_Sketch " << this << " >> get_records(): " << ret.size() << " transitions kept, " << m_pruned << " pruned.");
+    return ret;
+  }
+
+private:
+  /**
+   * Drops every tracked transition with a count at or below the median, and raises m_admit above it.
+   */
+  void prune(){
+    vector<uint32_t> counts;
+    counts.reserve(m_tracked.size());
+    for(auto &entry : m_tracked) counts.push_back(entry.second);
+    nth_element(counts.begin(), counts.begin() + counts.size() / 2, counts.end());
+    uint32_t median = counts[counts.size() / 2];
+
+    for(auto it = m_tracked.begin(); it != m_tracked.end();){
+      if((*it).second <= median){
+        it = m_tracked.erase(it);
+        m_pruned++;
+      }else{
+        it++;
+      }
+    }
+    m_admit = max(m_admit, median + 1);
+    LOG("Transition_Sketch " << this << " >> prune(): kept " << m_tracked.size() << ", admitting counts from " << m_admit);
+  }
+
+  /** splitmix64 over the context and next word, seeded per sketch row. */
+  static uint64_t hash_record(const Transition_Record &r, uint64_t seed){
+    uint64_t h = seed * 0x9e3779b97f4a7c15ULL;
+    for(int i = 0; i <= MAX_ORDER; i++){
+      h ^= i < MAX_ORDER ? r.context[i] : r.next;
+      h ^= h >> 30;
+      h *= 0xbf58476d1ce4e5b9ULL;
+      h ^= h >> 27;
+      h *= 0x94d049bb133111ebULL;
+      h ^= h >> 31;
+    }
+    return h;
+  }
+};
+
+#endif
@@ -0,0 +1,310 @@
+#include "LOG.hpp"
+
+#ifndef _H_TRANSITION_TABLE
+#define _H_TRANSITION_TABLE
+
+#include <vector>
+#include <cstdint>
+
+using namespace std;
+
+/**
+ * Counts how many times a token id follows a state in a language.
+ * Transitions are counted in flat arrays through an open-addressed hash table, and compile() lays them out
+ * as per-state successor arrays (CSR: offsets into one id array and one count array) for generation.
+ * compile() also builds a Walker/Vose alias table per state so sample() costs the same for any number of successors.
+ * The compiled arrays can also be attached from a compiled model file, which skips counting and compiling.
+ */
+class Transition_Table{
+  vector<uint64_t> m_keys; // (from << 32) | to of every distinct transition, in the order first seen.
+  vector<uint32_t> m_counts; // the count of every distinct transition. same index as m_keys.
+  vector<uint32_t> m_slots; // open-addressed hash table of transitions. holds index + 1, 0 means the slot is empty.
+
+  vector<uint32_t> m_offsets; // successors of state s are [m_offsets[s], m_offsets[s + 1]) in m_next and m_next_count.
+  vector<uint32_t> m_next; // the successor ids, grouped by state.
+  vector<uint32_t> m_next_count; // the successor counts, grouped by state.
+  vector<uint32_t> m_alias_prob; // alias table threshold of every successor slot. keep the slot if a 32 bit fraction is below it.
+  vector<uint32_t> m_alias; // alias table fallback of every successor slot. an index into m_next.
+  bool m_compiled; // false if the counts changed since the last compile().
+
+  // the compiled arrays that are read. they point into the vectors above, or into an attached model file.
+  bool m_attached; // true if the compiled arrays are attached.
+  uint32_t m_state_count; // the number of states in the compiled arrays.
+  uint32_t m_transition_count; // the number of successors in the compiled arrays.
+  const uint32_t *m_offsets_p;
+  const uint32_t *m_next_p;
+  const uint32_t *m_next_count_p;
+  const uint32_t *m_alias_prob_p;
+  const uint32_t *m_alias_p;
+
+public:
+  /** Constructor */
+  Transition_Table(){
+    m_slots.assign(64, 0);
+    m_compiled = false;
+    m_attached = false;
+    m_state_count = 0;
+    m_transition_count = 0;
+  }
+
+  /**
+   * Reads the compiled arrays from somewhere else instead. The arrays must outlive this object or the next add().
+   * uint32_t state_count: the number of states.
+   * uint32_t transition_count: the number of successors.
+   * const uint32_t *offsets, *next, *next_count, *alias_prob, *alias: the compiled arrays. see the members.
+   */
+  void attach(uint32_t state_count, uint32_t transition_count, const uint32_t *offsets, const uint32_t *next, const uint32_t *next_count, const uint32_t *alias_prob, const uint32_t *alias){
+    m_keys.clear(); m_counts.clear(); m_slots.clear();
+    m_offsets.clear(); m_next.clear(); m_next_count.clear(); m_alias_prob.clear(); m_alias.clear();
+    m_attached = true;
+    m_compiled = true;
+    m_state_count = state_count;
+    m_transition_count = transition_count;
+    m_offsets_p = offsets;
+    m_next_p = next;
+    m_next_count_p = next_count;
+    m_alias_prob_p = alias_prob;
+    m_alias_p = alias;
+  }
+
+  /**
+   * Adds to the count of a transition.
+   * uint32_t from: the state.
+   * uint32_t to: the token that came after the state.
+   * uint32_t count: the amount to add.
+   */
+  void add(uint32_t from, uint32_t to, uint32_t count = 1){
+    if(m_attached) detach();
+    uint64_t key = ((uint64_t) from << 32) | to;
+    size_t mask = m_slots.size() - 1;
+    size_t slot = hash_key(key) & mask;
+    while(m_slots[slot] != 0){
+      if(m_keys[m_slots[slot] - 1] == key){
+        m_counts[m_slots[slot] - 1] += count;
+        m_compiled = false;
+        return;
+      }
+      slot = (slot + 1) & mask;
+    }
+
+    m_keys.push_back(key);
+    m_counts.push_back(count);
+    m_slots[slot] = m_keys.size();
+    if(m_keys.size() * 2 > m_slots.size()) grow();
+    m_compiled = false;
+  }
+
+  /**
+   * Builds the per-state successor arrays. Successors keep the order they were first seen in.
+   * uint32_t state_count: the number of states. every state must be below this.
+   */
+  void compile(uint32_t state_count){
+    if(m_attached) detach();
+    m_offsets.assign(state_count + 1, 0);
+    for(size_t i = 0; i < m_keys.size(); i++){
+      m_offsets[get_from(i) + 1]++;
+    }
+    for(uint32_t s = 0; s < state_count; s++){
+      m_offsets[s + 1] += m_offsets[s];
+    }
+
+    vector<uint32_t> fill(m_offsets.begin(), m_offsets.end() - 1);
+    m_next.resize(m_keys.size());
+    m_next_count.resize(m_keys.size());
+    for(size_t i = 0; i < m_keys.size(); i++){
+      uint32_t pos = fill[get_from(i)]++;
+      m_next[pos] = get_to(i);
+      m_next_count[pos] = m_counts[i];
+    }
+
+    m_alias_prob.resize(m_keys.size());
+    m_alias.resize(m_keys.size());
+    for(uint32_t s = 0; s < state_count; s++){
+      build_alias(m_next_count.data() + m_offsets[s], m_offsets[s + 1] - m_offsets[s], m_offsets[s], m_alias_prob.data() + m_offsets[s], m_alias.data() + m_offsets[s]);
+    }
+
+    m_state_count = state_count;
+    m_transition_count = m_keys.size();
+    m_offsets_p = m_offsets.data();
+    m_next_p = m_next.data();
+    m_next_count_p = m_next_count.data();
+    m_alias_prob_p = m_alias_prob.data();
+    m_alias_p = m_alias.data();
+    m_compiled = true;
+  }
+
+  /**
+   * Picks a successor of a state, weighted by count. compile() must have been called.
+   * uint32_t state: the state. must have at least one successor.
+   * uint64_t rnd: a uniformly random 64 bit number.
+   * uint32_t return: the index of the picked successor.
+   */
+  uint32_t sample(uint32_t state, uint64_t rnd) const {
+    uint32_t begin = m_offsets_p[state];
+    uint64_t size = m_offsets_p[state + 1] - begin;
+    uint32_t slot = begin + (((rnd >> 32) * size) >> 32); // upper half picks a slot.
+    if((uint32_t) rnd < m_alias_prob_p[slot]) return slot; // lower half picks between the slot and its alias.
+    return m_alias_p[slot];
+  }
+
+  /** returns false if compile() has to be called before reading successors */
+  bool is_compiled() const {
+    return m_compiled;
+  }
+
+  /** returns true if the compiled arrays are attached from somewhere else */
+  bool is_attached() const {
+    return m_attached;
+  }
+
+  /** get the number of states in the compiled arrays */
+  uint32_t get_state_count() const {
+    return m_state_count;
+  }
+
+  /** get the index of the first successor of a state. */
+  uint32_t successor_begin(uint32_t state) const {
+    return state < m_state_count ? m_offsets_p[state] : 0;
+  }
+
+  /** get the index after the last successor of a state. */
+  uint32_t successor_end(uint32_t state) const {
+    return state < m_state_count ? m_offsets_p[state + 1] : 0;
+  }
+
+  /** get the successor id at an index. */
+  uint32_t get_next(uint32_t index) const {
+    return m_next_p[index];
+  }
+
+  /** get the successor count at an index. */
+  uint32_t get_next_count(uint32_t index) const {
+    return m_next_count_p[index];
+  }
+
+  /** get the alias table threshold at an index. */
+  uint32_t get_alias_prob(uint32_t index) const {
+    return m_alias_prob_p[index];
+  }
+
+  /** get the alias table fallback at an index. */
+  uint32_t get_alias(uint32_t index) const {
+    return m_alias_p[index];
+  }
+
+  /** get the number of distinct transitions */
+  size_t size() const {
+    return m_attached ? m_transition_count : m_keys.size();
+  }
+
+  /** get the state of the i-th distinct transition. not available while attached. */
+  uint32_t get_from(size_t i) const {
+    return m_keys[i] >> 32;
+  }
+
+  /** get the successor of the i-th distinct transition. not available while attached. */
+  uint32_t get_to(size_t i) const {
+    return (uint32_t) m_keys[i];
+  }
+
+  /** get the count of the i-th distinct transition. not available while attached. */
+  uint32_t get_count(size_t i) const {
+    return m_counts[i];
+  }
+
+  /**
+   * Builds the alias table of one state with Vose's method.
+   * const uint32_t *counts: the successor counts of the state.
+   * uint32_t size: the number of successors.
+   * uint32_t base: the index of the first successor. the alias of a slot is stored as base + its position.
+   * uint32_t *alias_prob: set to the size thresholds.
+   * uint32_t *alias: set to the size fallbacks.
+   */
+  static void build_alias(const uint32_t *counts, uint32_t size, uint32_t base, uint32_t *alias_prob, uint32_t *alias){
+    if(size == 0) return;
+    uint64_t total_count = 0;
+    for(uint32_t i = 0; i < size; i++){
+      total_count += counts[i];
+    }
+
+    vector<double> scaled(size); // probability of each successor times the number of successors.
+    vector<uint32_t> small, large;
+    for(uint32_t i = 0; i < size; i++){
+      scaled[i] = (double) counts[i] * size / total_count;
+      if(scaled[i] < 1.0){
+        small.push_back(i);
+      }else{
+        large.push_back(i);
+      }
+    }
+
+    while(!small.empty() && !large.empty()){
+      uint32_t s = small.back(); small.pop_back();
+      uint32_t l = large.back();
+      alias_prob[s] = to_threshold(scaled[s]);
+      alias[s] = base + l;
+      scaled[l] -= 1.0 - scaled[s];
+      if(scaled[l] < 1.0){
+        large.pop_back();
+        small.push_back(l);
+      }
+    }
+
+    // whatever is left is full up to rounding error.
+    for(uint32_t i : small){
+      alias_prob[i] = UINT32_MAX;
+      alias[i] = base + i;
+    }
+    for(uint32_t i : large){
+      alias_prob[i] = UINT32_MAX;
+      alias[i] = base + i;
+    }
+  }
+
+private:
+  /**
+   * Rebuilds the counts from the attached arrays so transitions can be added.
+   */
+  void detach(){
+    LOG("Transition_Table " << this << " >> detach(): copying " << m_transition_count << " transitions.");
+    m_attached = false;
+    m_slots.assign(64, 0);
+    for(uint32_t s = 0; s < m_state_count; s++){
+      for(uint32_t i = m_offsets_p[s]; i < m_offsets_p[s + 1]; i++){
+        add(s, m_next_p[i], m_next_count_p[i]);
+      }
+    }
+  }
+
+  /** converts a probability into a 32 bit threshold. */
+  static uint32_t to_threshold(double p){
+    if(p <= 0.0) return 0;
+    if(p >= 1.0) return UINT32_MAX;
+    return (uint32_t) (p * 4294967296.0);
+  }
+
+  /**
+   * Doubles the hash table and re-inserts every transition.
+   */
+  void grow(){
+    m_slots.assign(m_slots.size() * 2, 0);
+    size_t mask = m_slots.size() - 1;
+    for(size_t i = 0; i < m_keys.size(); i++){
+      size_t slot = hash_key(m_keys[i]) & mask;
+      while(m_slots[slot] != 0) slot = (slot + 1) & mask;
+      m_slots[slot] = i + 1;
+    }
+  }
+
+  /** splitmix64 finalizer */
+  static uint64_t hash_key(uint64_t key){
+    key ^= key >> 30;
+    key *= 0xbf58476d1ce4e5b9ULL;
+    key ^= key >> 27;
+    key *= 0x94d049bb133111ebULL;
+    key ^= key >> 31;
+    return key;
+  }
+};
+
+#endif
@@ -0,0 +1,226 @@
+#include "LOG.hpp"
+
+#ifndef _H_WINDOW_REGISTRY
+#define _H_WINDOW_REGISTRY
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <utility>
+#include <algorithm>
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+using namespace std;
+
+typedef void *Window_Handle; // a window. an HWND on Windows, so it can be passed to the Windows API with a cast.
+
+/**
+ * Interface for classes that list, activate and read the top-level windows of the desktop.
+ */
+class Window_Manager{
+public:
+  virtual ~Window_Manager(){}
+
+  /**
+   * Lists the top-level windows that have a title.
+   * vector<pair<Window_Handle, string>> &windows: set to the handle and title of every window, from the top of the Z order.
+   */
+  virtual void list_windows(vector<pair<Window_Handle, string>> &windows) = 0;
+
+  /**
+   * Brings a window to the front.
+   * Window_Handle window: the window.
+   * bool return: false if the window is gone or could not be brought to the front.
+   */
+  virtual bool activate(Window_Handle window) = 0;
+
+  /**
+   * Gets the title of the window that has the focus.
+   * string return: the title. an empty string if failed.
+   */
+  virtual string get_foreground_title() = 0;
+};
+
+#ifdef _WIN32
+/**
+ * The windows of the Windows desktop.
+ */
+class Windows_Window_Manager : public Window_Manager{
+public:
+  void list_windows(vector<pair<Window_Handle, string>> &windows){
+    windows.clear();
+    EnumWindows(add_window, (LPARAM) &windows);
+  }
+
+  bool activate(Window_Handle handle){
+    HWND window = (HWND) handle;
+    if(!IsWindow(window)) return false;
+    if(IsIconic(window)) ShowWindow(window, SW_RESTORE);
+    if(!SetForegroundWindow(window)) return false; // refused when another program has the foreground lock.
+    return GetForegroundWindow() == window;
+  }
+
+  string get_foreground_title(){
+    char wnd_title[256];
+    int length = GetWindowText(GetForegroundWindow(), wnd_title, sizeof(wnd_title));
+    if(length == 0) return "";
+    return wnd_title;
+  }
+
+private:
+  static BOOL CALLBACK add_window(HWND window, LPARAM windows){
+    if(!IsWindowVisible(window)) return TRUE;
+    char wnd_title[256];
+    int length = GetWindowText(window, wnd_title, sizeof(wnd_title));
+    if(length > 0) (*(vector<pair<Window_Handle, string>>*) windows).push_back(make_pair((Window_Handle) window, string(wnd_title, length)));
+    return TRUE;
+  }
+};
+#endif
+
+/**
+ * A Window_Manager with made-up windows that are opened and closed by hand.
+ * It counts the calls that would cost a round trip to the window manager.
+ */
+class Fake_Window_Manager : public Window_Manager{
+  vector<pair<Window_Handle, string>> m_windows; // every open window. the first one has the focus.
+  size_t m_next_handle; // the handle of the next window to open.
+  size_t m_list_calls; // the number of list_windows() calls so far.
+  size_t m_activate_calls; // the number of activate() calls so far.
+
+public:
+  /**
+   * Constructor. There are no windows.
+   */
+  Fake_Window_Manager(){
+    m_next_handle = 1;
+    m_list_calls = 0;
+    m_activate_calls = 0;
+  }
+
+  /**
+   * Opens a window on top of the others.
+   * string title: the title of the window.
+   * Window_Handle return: the handle of the window.
+   */
+  Window_Handle open_window(string title){
+    Window_Handle window = (Window_Handle) m_next_handle++;
+    m_windows.insert(m_windows.begin(), make_pair(window, title));
+    return window;
+  }
+
+  /**
+   * Closes a window.
+   * Window_Handle window: the handle of the window.
+   */
+  void close_window(Window_Handle window){
+    for(auto itr = m_windows.begin(); itr != m_windows.end(); itr++){
+      if((*itr).first == window){
+        m_windows.erase(itr);
+        return;
+      }
+    }
+  }
+
+  void list_windows(vector<pair<Window_Handle, string>> &windows){
+    m_list_calls++;
+    windows = m_windows;
+  }
+
+  bool activate(Window_Handle window){
+    m_activate_calls++;
+    for(auto itr = m_windows.begin(); itr != m_windows.end(); itr++){
+      if((*itr).first == window){
+        rotate(m_windows.begin(), itr, itr + 1);
+        return true;
+      }
+    }
+    return false;
+  }
+
+  string get_foreground_title(){
+    return m_windows.empty() ? "" : m_windows[0].second;
+  }
+
+  /** get the number of list_windows() calls so far */
+  size_t get_list_calls() const {
+    return m_list_calls;
+  }
+
+  /** get the number of activate() calls so far */
+  size_t get_activate_calls() const {
+    return m_activate_calls;
+  }
+};
+
+/**
+ * Finds windows by a part of their title and activates them directly, instead of alt-tabbing through them.
+ * The handle found for a name is cached, so the windows are only listed when a name is new or its window
+ * could not be activated anymore. A cached handle is dropped as soon as activating it fails or the window
+ * that comes to the front does not have the name in its title.
+ * Only the thread that sends may use the registry.
+ */
+class Window_Registry{
+  Window_Manager *m_manager; // the windows.
+  unordered_map<string, Window_Handle> m_cache; // the window found for every name.
+  vector<pair<Window_Handle, string>> m_windows; // the last listing. reused between calls.
+
+public:
+  /**
+   * Constructor
+   * Window_Manager *manager: the windows. it must outlive the registry.
+   */
+  Window_Registry(Window_Manager *manager){
+    LOG("Window_Registry " << this << " >> new");
+    m_manager = manager;
+  }
+
+  /**
+   * Brings the window with the title that contains a name to the front.
+   * const string &name: a part of the title.
+   * bool return: false if no window has the name or it could not be brought to the front.
+   */
+  bool activate(const string &name){
+    bool listed = false; // true once the windows were listed by this call.
+    while(true){
+      auto itr = m_cache.find(name);
+      if(itr == m_cache.end()){
+        if(!listed){
+          (*m_manager).list_windows(m_windows);
+          listed = true;
+        }
+        Window_Handle window = search(name);
+        if(window == NULL) return false;
+        itr = m_cache.emplace(name, window).first;
+      }
+      if((*m_manager).activate((*itr).second) && get_foreground_title().find(name) != string::npos) return true;
+      LOG("Window_Registry " << this << " >> activate(): the window of \"" << name << "\" could not be activated.");
+      m_cache.erase(itr);
+      if(listed) return false;
+    }
+  }
+
+  /**
+   * Gets the title of the window that has the focus.
+   * string return: the title. an empty string if failed.
+   */
+  string get_foreground_title(){
+    return (*m_manager).get_foreground_title();
+  }
+
+private:
+  /**
+   * Finds the top window of the last listing with the title that contains a name.
+   * Window_Handle return: the window. NULL if there is none.
+   */
+  Window_Handle search(const string &name){
+    for(auto itr = m_windows.begin(); itr != m_windows.end(); itr++){
+      if((*itr).second.find(name) != string::npos) return (*itr).first;
+    }
+    return NULL;
+  }
+};
+
+#endif
@@ -6,13 +6,18 @@
 
 #include "My_Library\Message_Handler.cpp"
 #include "My_Library\Message_Sender.cpp"
+#include "My_Library\Thread_Pool.cpp"
 
 #include <iostream>
 #include <sstream>
 #include <fstream>
 #include <string>
 #include <list>
+#include <vector>
+#include <memory>
 #include <unordered_map>
+#include <unordered_set>
+#include <thread>
 
 using namespace std;
 
@@ -20,7 +25,113 @@ int INPUT_DELAY = 80;
 int MAX_WINDOWS = 8;
 string RETURN_WINDOW_NAME = "MChat";
 int UPDATE_INTERVAL = 10000;
+int LEARN_THREADS = 1;
+string DELIMITERS = DEFAULT_DELIMITERS;
+int PREGENERATE = 4;
+int UPDATE_THREADS = 1;
+int SEND_BUDGET = 0;
+int QUEUE_CAPACITY = 64;
+Overflow_Policy QUEUE_OVERFLOW = DROP_OLDEST;
+int LEARN_MEMORY = 0;
+bool LEARN_APPROXIMATE = false;
+int KEY_BATCH = 0;
+int KEY_DELAY = 0;
+int RATE_MESSAGES = 0;
+int RATE_CHARACTERS = 0;
+int RELOAD_INTERVAL = 10000;
+bool LAZY_MODELS = false;
+int MODEL_LEAD = 300000;
+int MODEL_IDLE = 0;
+int LOAD_THREADS = 1;
 
+/**
+ * The values of every global setting at the time it is made, so they can be put back with apply().
+ */
+struct Global_Settings{
+  int input_delay = INPUT_DELAY;
+  int max_windows = MAX_WINDOWS;
+  string return_window_name = RETURN_WINDOW_NAME;
+  int update_interval = UPDATE_INTERVAL;
+  int learn_threads = LEARN_THREADS;
+  string delimiters = DELIMITERS;
+  int pregenerate = PREGENERATE;
+  int update_threads = UPDATE_THREADS;
+  int send_budget = SEND_BUDGET;
+  int queue_capacity = QUEUE_CAPACITY;
+  Overflow_Policy queue_overflow = QUEUE_OVERFLOW;
+  int learn_memory = LEARN_MEMORY;
+  bool learn_approximate = LEARN_APPROXIMATE;
+  int key_batch = KEY_BATCH;
+  int key_delay = KEY_DELAY;
+  int rate_messages = RATE_MESSAGES;
+  int rate_characters = RATE_CHARACTERS;
+  int reload_interval = RELOAD_INTERVAL;
+  bool lazy_models = LAZY_MODELS;
+  int model_lead = MODEL_LEAD;
+  int model_idle = MODEL_IDLE;
+  int load_threads = LOAD_THREADS;
+
+  /** sets every global setting to the value it had when this was made */
+  void apply() const {
+    INPUT_DELAY = input_delay;
+    MAX_WINDOWS = max_windows;
+    RETURN_WINDOW_NAME = return_window_name;
+    UPDATE_INTERVAL = update_interval;
+    LEARN_THREADS = learn_threads;
+    DELIMITERS = delimiters;
+    PREGENERATE = pregenerate;
+    UPDATE_THREADS = update_threads;
+    SEND_BUDGET = send_budget;
+    QUEUE_CAPACITY = queue_capacity;
+    QUEUE_OVERFLOW = queue_overflow;
+    LEARN_MEMORY = learn_memory;
+    LEARN_APPROXIMATE = learn_approximate;
+    KEY_BATCH = key_batch;
+    KEY_DELAY = key_delay;
+    RATE_MESSAGES = rate_messages;
+    RATE_CHARACTERS = rate_characters;
+    RELOAD_INTERVAL = reload_interval;
+    LAZY_MODELS = lazy_models;
+    MODEL_LEAD = model_lead;
+    MODEL_IDLE = model_idle;
+    LOAD_THREADS = load_threads;
+  }
+};
+
+const Global_Settings DEFAULT_GLOBALS; // made before any config is read.
+
+/**
+ * A sender block of the config file, with the global settings as they were at the block.
+ */
+struct Sender_Spec{
+  bool ct = false; // an MS_CT block if true, an MS_STANDARD block otherwise.
+  string window; // the name of the window.
+  string sub_window; // the name of the sub window. MS_CT only.
+  bool paste = false; // pastes the messages instead of typing them.
+  Send_Limits limits;
+  int input_delay = 0;
+  int max_windows = 0;
+  string return_window;
+  int queue_capacity = 0;
+  Overflow_Policy overflow = DROP_OLDEST;
+};
+
+/**
+ * A handler block of the config file, read before anything is built.
+ */
+struct Handler_Spec{
+  bool markov = false; // a WH_MARKOV block if true, a WH_AUTO block otherwise.
+  string message; // WH_AUTO only.
+  string path; // the sample text file. WH_MARKOV only.
+  bool dictionary = false; // WH_MARKOV only.
+  Language_Options options; // WH_MARKOV only.
+  Load_Options load; // WH_MARKOV only.
+  int pregenerate = 0; // WH_MARKOV only.
+  int min = 0; // the shortest interval between messages.
+  int max = 0; // the longest interval between messages.
+  Sender_Spec sender;
+  Schedule *schedule = NULL; // set by the schedule block after it.
+};
 
 /**
  * Class that is responsible for reading the config file and setting up the list of
@@ -29,205 +140,451 @@ int UPDATE_INTERVAL = 10000;
 class Main_Parser{
 private:
   unordered_map<string, Message_Sender*> MS_map;
+  unordered_map<string, string> m_settings; // the settings every sender in MS_map was made with. see make_settings().
+  unordered_map<string, pair<Message_Sender*, string>> m_previous; // the senders of an earlier parse that were not reused yet, with their settings.
+  unordered_multimap<string, Message_Handler*> m_handlers; // the handlers made by the last parse. see handler_key().
+  unordered_multimap<string, Message_Handler*> m_previous_handlers; // the handlers of an earlier parse, while parse() runs.
+  bool m_dry_run; // makes MS_Stub senders instead of windows if true.
+  Key_Backend *m_keys; // types for every window sender. made with the first one, lives as long as them.
+  Clipboard *m_clipboard; // pastes for every window sender in the paste mode. made with the first one, lives as long as them.
+  Window_Registry *m_windows; // finds the windows of every window sender. made with the first one, lives as long as them.
 public:
+  /**
+   * Constructor
+   * bool dry_run: makes senders that drop every message if true.
+   */
+  Main_Parser(bool dry_run = false){
+    m_dry_run = dry_run;
+    m_keys = NULL;
+    m_clipboard = NULL;
+    m_windows = NULL;
+  }
+
+  /**
+   * Lets parse() reuse the senders of an earlier parse that would be made with the same settings,
+   * so they keep their queues and what they know about their windows. Call it before parse().
+   * The new handlers of unchanged handler blocks continue the timing of the old ones.
+   * Main_Parser &previous: the parser of the earlier parse. it still knows its senders, so it can be kept if parse() fails.
+   */
+  void reuse(Main_Parser &previous){
+    for(auto itr = previous.MS_map.begin(); itr != previous.MS_map.end(); itr++){
+      m_previous.emplace((*itr).first, make_pair((*itr).second, previous.m_settings[(*itr).first]));
+    }
+    m_previous_handlers = previous.m_handlers;
+    m_keys = previous.m_keys;
+    m_clipboard = previous.m_clipboard;
+    m_windows = previous.m_windows;
+  }
+
+  /**
+   * Gets the senders of the earlier parse that parse() did not reuse. Delete them once nothing sends with them anymore.
+   * list<Message_Sender*> &unused: the senders are added to it.
+   */
+  void get_unused(list<Message_Sender*> &unused){
+    for(auto itr = m_previous.begin(); itr != m_previous.end(); itr++){
+      unused.push_back((*itr).second.first);
+    }
+    m_previous.clear();
+  }
+
   /**
    * Takes a file input stream and reads it. Will build the list of Message_Sender
    * and Message_Handler objects.
+   * The file is read first, then the corpora of the Markov handlers are learned in parallel,
+   * then the senders and handlers are made in the order of the file.
+   * Every global setting that the file does not set has its default value.
    * ifstream& ss: File input stream of the config file.
    * list<Message_Handler*>& MH_list: List of Message_Handler objects to be built.
    * list<Message_Sender*>& MS_list: List of Message_Sender objects to be built.
+   * bool return: false if the file has an error. nothing is built then and the global settings are left as they were.
+   */
+  bool parse(ifstream& ss, list<Message_Handler*>& MH_list, list<Message_Sender*>& MS_list){
+    Global_Settings previous;
+    DEFAULT_GLOBALS.apply();
+    vector<Handler_Spec> specs;
+    if(!read_specs(ss, specs)){
+      previous.apply();
+      return false;
+    }
+    vector<shared_ptr<const Language>> languages; // keeps the languages until the handlers hold them.
+    learn_languages(specs, languages);
+    for(auto itr = specs.begin(); itr != specs.end(); itr++){
+      const Handler_Spec &spec = *itr;
+      Message_Sender *ms = add_MS(spec.sender, MS_list);
+      Message_Handler *mh;
+      if(spec.markov){
+        mh = new Markov_Generator(spec.schedule, ms, spec.dictionary, spec.path, spec.min, spec.max, spec.options, spec.pregenerate, spec.load);
+      }else{
+        mh = new Word_Handler(spec.schedule, ms, spec.message, spec.min, spec.max);
+      }
+      string key = handler_key(spec);
+      auto previous = m_previous_handlers.find(key);
+      if(previous != m_previous_handlers.end()){ // the same block was in the earlier config.
+        (*mh).continue_from(*(*previous).second);
+        m_previous_handlers.erase(previous);
+      }
+      m_handlers.emplace(key, mh);
+      MH_list.push_back(mh);
+    }
+    m_previous_handlers.clear(); // the caller deletes them.
+    LOG("Main_Parser " << this << " >> parse(): Finished parsing.");
+    return true;
+  }
+
+private:
+  /**
+   * Reads the config file into a spec for every handler block. Global lines are applied as they are read.
+   * ifstream& ss: File input stream of the config file.
+   * vector<Handler_Spec> &specs: the handler blocks are added to it.
+   * bool return: false if the file has an error.
    */
-  void parse(ifstream& ss, list<Message_Handler*>& MH_list, list<Message_Sender*>& MS_list){
+  bool read_specs(ifstream& ss, vector<Handler_Spec> &specs){
     string line;
-    Schedule *current_schedule = new Schedule();
+    Schedule *current_schedule = Schedule::intern(Schedule()); // handlers without a schedule block after them are never on.
+    size_t scheduled = specs.size(); // the handlers before this one already have their schedule.
     while(getline(ss, line)){
       if(!(line[0] == '/' && line[1] == '/') && !(line[0] == '\r') && !(line[0] == '\n')){ // skip line if it starts with "//" or is a empty line.
         switch(line[0]){
           case '>':
-            parse_MH(ss, current_schedule, MH_list, MS_list);
+            specs.emplace_back();
+            specs.back().schedule = current_schedule;
+            if(!parse_MH(ss, specs.back())) return false;
             break;
-          case '{':
-            parse_schedule(ss, current_schedule);
-            current_schedule = new Schedule();
+          case '{':{ // the schedule of every handler since the last schedule block.
+            Schedule schedule;
+            if(!parse_schedule(ss, &schedule)) return false;
+            Schedule *shared = Schedule::intern(schedule);
+            for(size_t i = scheduled; i < specs.size(); i++){
+              specs[i].schedule = shared;
+            }
+            scheduled = specs.size();
             break;
+          }
           case 'g':
-            parse_global(line);
+            if(!parse_global(line)) return false;
             break;
           default:
-            LOG("Main_Parser " << this << " >> parse(): Unknown line \"" << line << "\" Exiting program...");
-            exit(1);
+            LOG("Main_Parser " << this << " >> read_specs(): Unknown line \"" << line << "\"");
+            return false;
         }
       }
     }
-    LOG("Main_Parser " << this << " >> parse(): Finished parsing.");
+    if(SEND_BUDGET > 0){ // the handlers and the senders share the main thread, so a blocked queue would never be emptied.
+      if(QUEUE_OVERFLOW == BLOCK) QUEUE_OVERFLOW = DROP_OLDEST;
+      for(size_t i = 0; i < specs.size(); i++){
+        if(specs[i].sender.overflow == BLOCK){
+          LOG("Main_Parser " << this << " >> read_specs(): queue_overflow block does not work with send_budget. using drop_oldest for " << specs[i].sender.window);
+          specs[i].sender.overflow = DROP_OLDEST;
+        }
+      }
+    }
+    return true;
   }
 
-private:
-  void parse_MH(ifstream& ss, Schedule *current_schedule, list<Message_Handler*>& MH_list, list<Message_Sender*>& MS_list){
+  /**
+   * Learns the corpora of the Markov handlers that are not loaded lazily, load_threads of them at a time.
+   * A corpus that several handlers use is learned once.
+   * const vector<Handler_Spec> &specs: the handler blocks.
+   * vector<shared_ptr<const Language>> &languages: set to the learned languages. the Language_Registry shares them while they are held.
+   */
+  void learn_languages(const vector<Handler_Spec> &specs, vector<shared_ptr<const Language>> &languages){
+    vector<const Handler_Spec*> corpora;
+    unordered_set<string> keys;
+    for(auto itr = specs.begin(); itr != specs.end(); itr++){
+      if((*itr).markov && !(*itr).load.lazy && keys.insert(Language_Registry::make_key((*itr).path, (*itr).dictionary, (*itr).options)).second){
+        corpora.push_back(&*itr);
+      }
+    }
+    languages.resize(corpora.size());
+    if(corpora.empty()) return;
+    Thread_Pool pool(min(LOAD_THREADS, (int) corpora.size()));
+    pool.run(corpora.size(), [&](size_t i){
+      languages[i] = Language_Registry::get((*corpora[i]).path, (*corpora[i]).dictionary, (*corpora[i]).options);
+    });
+  }
+
+  bool parse_MH(ifstream& ss, Handler_Spec &spec){
     string line;
     if(getline(ss, line)){
       if(line == "WH_AUTO"){
-        parse_MH_AUTO(ss, current_schedule, MH_list, MS_list);
-        return;
+        return parse_MH_AUTO(ss, spec);
       }else if(line == "WH_MARKOV"){
-        parse_MH_MARKOV(ss, current_schedule, MH_list, MS_list);
-        return;
+        return parse_MH_MARKOV(ss, spec);
       }
     }
-    LOG("Main_Parser " << this << " >> parse_MH(): Error at line \"" << line << "\" Exiting program...");
-    exit(1);
+    LOG("Main_Parser " << this << " >> parse_MH(): Error at line \"" << line << "\"");
+    return false;
   }
 
-  void parse_MH_AUTO(ifstream& ss, Schedule *current_schedule, list<Message_Handler*>& MH_list, list<Message_Sender*>& MS_list){
-    string line, message;
-    int min, max;
-    Message_Sender* ms;
-    Message_Handler* mh;
+  bool parse_MH_AUTO(ifstream& ss, Handler_Spec &spec){
+    string line;
 
     if(getline(ss, line)){
-      message = line;
-      message.append("\n");
+      spec.message = line;
+      spec.message.append("\n");
     }else{
       goto error;
     }
 
     if(getline(ss, line)){
       stringstream ss(line);
-      ss >> min >> max;
+      ss >> spec.min >> spec.max;
       if(ss.fail()) goto error;
     }else{
       goto error;
     }
 
-    if(getline(ss, line)){
-      if(line == "MS_STANDARD"){
-        if(!getline(ss, line)) goto error;
-        ms = add_MS(line, MS_list);
-      }else if(line == "MS_CT"){
-        if(!getline(ss, line)) goto error;
-        string tmp;
-        if(!getline(ss, tmp)) goto error;
-        ms = add_MS(line, tmp, MS_list);
-      }
-    }
+    if(!parse_MS(ss, line, spec.sender)) goto error;
 
     if(!getline(ss, line)) goto error;
     if(!(line == "<")) goto error;
 
-    mh = new Word_Handler(current_schedule, ms, message, min, max);
-
-    MH_list.push_back(mh);
-
-    return;
+    return true;
 
   error:
-    LOG("Main_Parse " << this << " >> parse_MH_AUTO(): Error at line \"" << line << "\" Exiting program...");
-    exit(1);
+    LOG("Main_Parse " << this << " >> parse_MH_AUTO(): Error at line \"" << line << "\"");
+    return false;
   }
 
-  void parse_MH_MARKOV(ifstream& ss, Schedule *current_schedule, list<Message_Handler*>& MH_list, list<Message_Sender*>& MS_list){
-    string line, message, path;
-    int min, max;
-    Message_Sender* ms;
-    Message_Handler* mh;
-    bool dictionary;
+  bool parse_MH_MARKOV(ifstream& ss, Handler_Spec &spec){
+    string line;
+    spec.markov = true;
+    spec.options = language_options();
+    spec.load = load_options();
+    spec.pregenerate = m_dry_run ? 0 : PREGENERATE; // the dry run times the generation, which would run uncounted on the pool thread.
 
     if(getline(ss, line)){
       stringstream ss(line);
       string tmp;
-      ss >> tmp >> path;
+      ss >> tmp >> spec.path;
 
       if(ss.fail()) goto error;
+      if(!(ss >> ws).eof()){ // optional order of the markov chain. nothing else may follow the path.
+        if(!(ss >> spec.options.order) || spec.options.order < 1 || MAX_ORDER < spec.options.order) goto error;
+        if(!(ss >> ws).eof()) goto error;
+      }
 
       if(tmp == "TRUE"){
-        dictionary = true;
+        spec.dictionary = true;
       }else if(tmp == "FALSE"){
-        dictionary = false;
+        spec.dictionary = false;
       }else{
         goto error;
       }
+      if(!ifstream(spec.path).is_open()){ // checked here, learning it would end the program.
+        LOG("Main_Parse " << this << " >> parse_MH_MARKOV(): can not read " << spec.path);
+        goto error;
+      }
     }else{
       goto error;
     }
 
     if(getline(ss, line)){
       stringstream ss(line);
-      ss >> min >> max;
+      ss >> spec.min >> spec.max;
       if(ss.fail()) goto error;
     }else{
       goto error;
     }
 
-    if(getline(ss, line)){
-      if(line == "MS_STANDARD"){
-        if(!getline(ss, line)) goto error;
-        ms = add_MS(line, MS_list);
-      }else if(line == "MS_CT"){
-        if(!getline(ss, line)) goto error;
-        string tmp;
-        if(!getline(ss, tmp)) goto error;
-        ms = add_MS(line, tmp, MS_list);
-      }
-    }
+    if(!parse_MS(ss, line, spec.sender)) goto error;
 
     if(!getline(ss, line)) goto error;
     if(!(line == "<")) goto error;
 
-    mh = new Markov_Generator(current_schedule, ms, dictionary, path, min, max);
+    return true;
 
-    MH_list.push_back(mh);
+  error:
+    LOG("Main_Parse " << this << " >> parse_MH_MARKOV(): Error at line \"" << line << "\"");
+    return false;
+  }
 
-    return;
+  /**
+   * Reads a sender block: "MS_STANDARD" and the window, or "MS_CT", the window and the sub window.
+   * ifstream& ss: file input stream
+   * string &line: set to the last line read.
+   * Sender_Spec &sender: set to the sender of the block.
+   * bool return: false if the block could not be read.
+   */
+  bool parse_MS(ifstream& ss, string &line, Sender_Spec &sender){
+    if(!getline(ss, line)) return false;
+    if(!parse_send_mode(line, sender.paste, sender.limits)) return false;
+    if(line == "MS_CT"){
+      sender.ct = true;
+    }else if(!(line == "MS_STANDARD")){
+      return false;
+    }
+    if(!getline(ss, line)) return false;
+    sender.window = line;
+    if(sender.ct && !getline(ss, sender.sub_window)) return false;
+    sender.input_delay = INPUT_DELAY;
+    sender.max_windows = MAX_WINDOWS;
+    sender.return_window = RETURN_WINDOW_NAME;
+    sender.queue_capacity = QUEUE_CAPACITY;
+    sender.overflow = QUEUE_OVERFLOW;
+    return true;
+  }
 
-  error:
-    LOG("Main_Parse " << this << " >> parse_MH_AUTO(): Error at line \"" << line << "\" Exiting program...");
-    exit(1);
+  /**
+   * Gets the key of a sender block. Blocks with the same key share a sender.
+   */
+  string sender_key(const Sender_Spec &sender){
+    string key;
+    if(sender.ct){ // create custom key for CT.
+      key = sender.paste ? "MChat PASTE MS_CT " : "MChat MS_CT ";
+      key.append(sender.window);
+      key.append(" ");
+      key.append(sender.sub_window);
+    }else{
+      key = sender.paste ? "MChat PASTE " + sender.window : sender.window; // a pasting sender is not shared with a typing one.
+    }
+    return key;
   }
 
-  Message_Sender* add_MS(string window_name, list<Message_Sender*>& MS_list){
-    Message_Sender* ret;
-    try{
-      ret = MS_map.at(window_name);
-    }catch(out_of_range&){
-      Message_Sender *new_MS = new MS_Window(INPUT_DELAY, MAX_WINDOWS, window_name, RETURN_WINDOW_NAME);
-      MS_list.push_front(new_MS);
-      MS_map.emplace(window_name, new_MS);
-      ret = new_MS;
+  /**
+   * Gets the key of a handler block: everything that changes when or where it sends. Schedules are interned, so equal ones have the same address.
+   */
+  string handler_key(const Handler_Spec &spec){
+    stringstream ss;
+    ss << spec.markov << " " << spec.min << " " << spec.max << " " << spec.schedule << " " << sender_key(spec.sender) << "\n";
+    if(spec.markov){
+      ss << Language_Registry::make_key(spec.path, spec.dictionary, spec.options);
+    }else{
+      ss << spec.message;
     }
+    return ss.str();
+  }
+
+  /**
+   * Gets the sender of a sender block, making it unless a block before it or an earlier parse made it already.
+   * const Sender_Spec &sender: the sender block.
+   * list<Message_Sender*>& MS_list: a new sender is added to it.
+   * Message_Sender* return: the sender.
+   */
+  Message_Sender* add_MS(const Sender_Spec &sender, list<Message_Sender*>& MS_list){
+    string key = sender_key(sender);
+
+    auto itr = MS_map.find(key);
+    if(itr != MS_map.end()) return (*itr).second;
+
+    string settings = make_settings(sender);
+    Message_Sender *new_MS = reuse_MS(key, settings);
+    if(new_MS != NULL){
+      // kept from the earlier parse.
+    }else if(m_dry_run){
+      new_MS = new MS_Stub(sender.ct ? sender.window + " " + sender.sub_window : sender.window);
+    }else if(sender.ct){
+      new_MS = new MS_Window_CT(sender.input_delay, sender.max_windows, sender.window, sender.return_window, sender.sub_window, sender.queue_capacity, sender.overflow,
+                                get_keys(), get_clipboard(sender.paste), get_windows(), sender.limits);
+    }else{
+      new_MS = new MS_Window(sender.input_delay, sender.max_windows, sender.window, sender.return_window, sender.queue_capacity, sender.overflow,
+                             get_keys(), get_clipboard(sender.paste), get_windows(), sender.limits);
+    }
+    MS_list.push_front(new_MS);
+    MS_map.emplace(key, new_MS);
+    m_settings.emplace(key, settings);
+    return new_MS;
+  }
 
+  /**
+   * Takes the sender of a key from the earlier parse if it was made with the same settings.
+   * Message_Sender *return: the sender. NULL if there is none.
+   */
+  Message_Sender *reuse_MS(const string &key, const string &settings){
+    auto itr = m_previous.find(key);
+    if(itr == m_previous.end() || (*itr).second.second != settings) return NULL;
+    Message_Sender *ret = (*itr).second.first;
+    m_previous.erase(itr);
+    LOG("Main_Parser " << this << " >> reuse_MS(): reusing " << ret << " for " << key);
     return ret;
   }
 
-  Message_Sender* add_MS(string window_name, string sub_window_name, list<Message_Sender*>& MS_list){
-    Message_Sender* ret;
-    string key;
+  /**
+   * Describes every setting a sender is made with, besides the ones in its key.
+   */
+  string make_settings(const Sender_Spec &sender){
+    stringstream ss;
+    ss << m_dry_run << " " << sender.input_delay << " " << sender.max_windows << " " << sender.return_window << " " << sender.queue_capacity << " " << sender.overflow << " "
+       << sender.paste << " " << sender.limits.messages_per_minute << " " << sender.limits.characters_per_minute << " " << sender.limits.retry_interval;
+    return ss.str();
+  }
+
+  /**
+   * Gets the Key_Backend of the window senders, making it with the global settings the first time.
+   */
+  Key_Backend *get_keys(){
+    if(m_keys == NULL) m_keys = new SendInput_Backend(KEY_BATCH, KEY_DELAY);
+    return m_keys;
+  }
 
-    // create custom key for CT.
-    key = "MChat MS_CT ";
-    key.append(window_name);
-    key.append(" ");
-    key.append(sub_window_name);
-
-    try{
-      ret = MS_map.at(key);
-    }catch(out_of_range&){
-      Message_Sender *new_MS = new MS_Window_CT(INPUT_DELAY, MAX_WINDOWS, window_name, RETURN_WINDOW_NAME, sub_window_name);
-      MS_list.push_front(new_MS);
-      MS_map.emplace(key, new_MS);
-      ret = new_MS;
+  /**
+   * Gets the Window_Registry of the window senders, making it the first time.
+   */
+  Window_Registry *get_windows(){
+    if(m_windows == NULL) m_windows = new Window_Registry(new Windows_Window_Manager());
+    return m_windows;
+  }
+
+  /**
+   * Gets the Clipboard of the window senders in the paste mode, making it the first time.
+   * bool paste: false for a sender that types.
+   * Clipboard *return: NULL if paste is false.
+   */
+  Clipboard *get_clipboard(bool paste){
+    if(!paste) return NULL;
+    if(m_clipboard == NULL) m_clipboard = new Windows_Clipboard();
+    return m_clipboard;
+  }
+
+  /**
+   * Reads the options after the type on the first line of a sender block: "MS_CT [PASTE] [RATE <messages> <characters>]".
+   * PASTE pastes every line of a message and presses enter, instead of typing it.
+   * RATE limits the messages and characters per minute of the sender, instead of the global rate_messages and rate_characters.
+   * The options of the first block of a window count, later blocks share its sender.
+   * string &line: the first line of the sender block. set to the type of the sender.
+   * bool &paste: set to true if the messages are pasted.
+   * Send_Limits &limits: set to the limits of the sender.
+   * bool return: false if an option could not be read.
+   */
+  bool parse_send_mode(string &line, bool &paste, Send_Limits &limits){
+    stringstream ss(line);
+    string option;
+    ss >> line;
+    paste = false;
+    limits = send_limits();
+    while(ss >> option){
+      if(option == "PASTE"){
+        paste = true;
+      }else if(option == "RATE"){
+        ss >> limits.messages_per_minute >> limits.characters_per_minute;
+        if(ss.fail() || limits.messages_per_minute < 0 || limits.characters_per_minute < 0) return false;
+      }else{
+        return false;
+      }
     }
+    return true;
+  }
 
-    return ret;
+  /**
+   * Gets the Send_Limits set by the global settings.
+   */
+  Send_Limits send_limits(){
+    Send_Limits limits;
+    limits.messages_per_minute = RATE_MESSAGES;
+    limits.characters_per_minute = RATE_CHARACTERS;
+    limits.retry_interval = UPDATE_INTERVAL;
+    return limits;
   }
 
   /**
    * Parses the input for setting up schedules.
    * ifstream& ss: file input stream
    * Schedule *schedule: the schedule that is to be built
+   * bool return: false if a time could not be read or the block does not end.
    */
-  void parse_schedule(ifstream& ss, Schedule *schedule){
+  bool parse_schedule(ifstream& ss, Schedule *schedule){
     string line;
-    int current_day_of_week;
+    int current_day_of_week = -1;
     while(getline(ss, line)){
       if(!(line[0] == '/' && line[1] == '/') || line[0] == '\n'){// skips line if it starts with "//" or "\n".
         switch(line[0]){
@@ -235,17 +592,19 @@ private:
             current_day_of_week = get_day_of_week(line);
             break;
           case '=': // get time
-            set_time(line, current_day_of_week, schedule);
+            if(!set_time(line, current_day_of_week, schedule)) return false;
             break;
           case '}': // finish parsing schedule
-            return;
+            return true;
             break;
           default:
-            LOG("Main_Parser " << this << " >> parse_schedule(): Unknown line \"" << line << "\" Exiting program...");
+            LOG("Main_Parser " << this << " >> parse_schedule(): Unknown line \"" << line << "\"");
             break;
         }
       }
     }
+    LOG("Main_Parser " << this << " >> parse_schedule(): the schedule block does not end.");
+    return false;
   }
 
   /**
@@ -279,27 +638,75 @@ private:
    * string line: given line.
    * int current_day_of_week: the current day of week to set the time.
    * Schedule *schedule: the schedule to be edited.
+   * bool return: false if the line could not be read.
    */
-  void set_time(string line, int current_day_of_week, Schedule *schedule){
-    if(current_day_of_week == -1 || schedule == NULL){ // exit if error is detected.
-      LOG("Main_Parser " << this << " >> set_time(): Error at line \"" << line << "\" Exiting program...");
-      exit(1);
-    }
+  bool set_time(string line, int current_day_of_week, Schedule *schedule){
     stringstream ss(line);
     int s_hour, s_minute, e_hour, e_minute;
     char dummy;
     ss >> dummy >> s_hour >> dummy >> s_minute >> dummy >> e_hour >> dummy >> e_minute;
+    if(current_day_of_week == -1 || schedule == NULL || ss.fail() || s_hour < 0 || s_minute < 0 || e_hour < 0 || e_minute < 0){
+      LOG("Main_Parser " << this << " >> set_time(): Error at line \"" << line << "\"");
+      return false;
+    }
     s_hour = s_hour % 24; e_hour = e_hour % 24; s_minute = s_minute % 60; e_minute = e_minute % 60;
 
     int start, end;
     start = s_hour * QUANTUM_NUMBER + s_minute / (60 / QUANTUM_NUMBER);
     end = e_hour * QUANTUM_NUMBER + e_minute / (60 / QUANTUM_NUMBER);
-    for(int i = start; i < end; i++){
-      (*schedule).set_schedule(current_day_of_week, i, true);
+    if(start < end) (*schedule).add(current_day_of_week, start, end);
+    return true;
+  }
+
+  /**
+   * Gets the Language_Options set by the global settings.
+   */
+  Language_Options language_options(){
+    Language_Options options;
+    options.learn_threads = LEARN_THREADS;
+    options.delimiters = DELIMITERS;
+    options.memory_budget = (size_t) LEARN_MEMORY * 1024 * 1024;
+    options.approximate = LEARN_APPROXIMATE;
+    return options;
+  }
+
+  /**
+   * Gets the Load_Options set by the global settings.
+   */
+  Load_Options load_options(){
+    Load_Options load;
+    load.lazy = LAZY_MODELS && !m_dry_run; // the virtual time of the dry run would pass long before a background load is done.
+    load.lead = MODEL_LEAD;
+    load.idle = MODEL_IDLE;
+    return load;
+  }
+
+  /**
+   * Replaces escape sequences so whitespace can be written in a config line.
+   * "\s" is a space, "\t" is a tab, "\r" and "\n" are line breaks and "\\" is a backslash.
+   * string token: the escaped string.
+   * string return: the unescaped string.
+   */
+  string unescape(string token){
+    string ret;
+    for(unsigned int i = 0; i < token.length(); i++){
+      if(token[i] == '\\' && i + 1 < token.length()){
+        i++;
+        switch(token[i]){
+          case 's': ret.push_back(' '); break;
+          case 't': ret.push_back('\t'); break;
+          case 'r': ret.push_back('\r'); break;
+          case 'n': ret.push_back('\n'); break;
+          default: ret.push_back(token[i]); break;
+        }
+      }else{
+        ret.push_back(token[i]);
+      }
     }
+    return ret;
   }
 
-  void parse_global(string line){
+  bool parse_global(string line){
     stringstream ss(line);
     string token;
     int tmp;
@@ -322,6 +729,89 @@ private:
       ss >> tmp;
       if(ss.fail()) goto error;
       UPDATE_INTERVAL = tmp;
+    }else if(token == "update_threads"){
+      ss >> tmp;
+      if(ss.fail()) goto error;
+      if(tmp <= 0) tmp = thread::hardware_concurrency(); // 0 means one thread per core.
+      UPDATE_THREADS = tmp;
+    }else if(token == "learn_threads"){
+      ss >> tmp;
+      if(ss.fail()) goto error;
+      if(tmp <= 0) tmp = thread::hardware_concurrency(); // 0 means one thread per core.
+      LEARN_THREADS = tmp;
+    }else if(token == "load_threads"){
+      ss >> tmp;
+      if(ss.fail()) goto error;
+      if(tmp <= 0) tmp = thread::hardware_concurrency(); // 0 means one thread per core.
+      LOAD_THREADS = tmp; // corpora learned at the same time while parsing.
+    }else if(token == "delimiters"){
+      ss >> token;
+      if(ss.fail()) goto error;
+      DELIMITERS = unescape(token);
+    }else if(token == "pregenerate"){
+      ss >> tmp;
+      if(ss.fail() || tmp < 0) goto error;
+      PREGENERATE = tmp;
+    }else if(token == "send_budget"){
+      ss >> tmp;
+      if(ss.fail() || tmp < 0) goto error;
+      SEND_BUDGET = tmp; // keystrokes per sender per tick. 0 types everything on the send worker.
+    }else if(token == "queue_capacity"){
+      ss >> tmp;
+      if(ss.fail() || tmp <= 0) goto error;
+      QUEUE_CAPACITY = tmp;
+    }else if(token == "queue_overflow"){
+      ss >> token;
+      if(ss.fail()) goto error;
+      if(token == "drop_oldest"){
+        QUEUE_OVERFLOW = DROP_OLDEST;
+      }else if(token == "drop_newest"){
+        QUEUE_OVERFLOW = DROP_NEWEST;
+      }else if(token == "block"){
+        QUEUE_OVERFLOW = BLOCK;
+      }else{
+        goto error;
+      }
+    }else if(token == "rate_messages"){
+      ss >> tmp;
+      if(ss.fail() || tmp < 0) goto error;
+      RATE_MESSAGES = tmp; // per minute per sender. 0 means unlimited.
+    }else if(token == "rate_characters"){
+      ss >> tmp;
+      if(ss.fail() || tmp < 0) goto error;
+      RATE_CHARACTERS = tmp; // per minute per sender. 0 means unlimited.
+    }else if(token == "lazy_models"){
+      ss >> token;
+      if(ss.fail() || !(token == "TRUE" || token == "FALSE")) goto error;
+      LAZY_MODELS = token == "TRUE";
+    }else if(token == "model_lead"){
+      ss >> tmp;
+      if(ss.fail() || tmp < 0) goto error;
+      MODEL_LEAD = tmp; // in milliseconds.
+    }else if(token == "model_idle"){
+      ss >> tmp;
+      if(ss.fail() || tmp < 0) goto error;
+      MODEL_IDLE = tmp; // in milliseconds. 0 never frees a model.
+    }else if(token == "reload_interval"){
+      ss >> tmp;
+      if(ss.fail() || tmp < 0) goto error;
+      RELOAD_INTERVAL = tmp; // how often config.txt is checked for changes. in milliseconds. 0 never reloads.
+    }else if(token == "key_batch"){
+      ss >> tmp;
+      if(ss.fail() || tmp < 0) goto error;
+      KEY_BATCH = tmp; // key events per SendInput() call. 0 sends a whole message in one call.
+    }else if(token == "key_delay"){
+      ss >> tmp;
+      if(ss.fail() || tmp < 0) goto error;
+      KEY_DELAY = tmp;
+    }else if(token == "learn_memory"){
+      ss >> tmp;
+      if(ss.fail() || tmp < 0) goto error;
+      LEARN_MEMORY = tmp; // in megabytes. 0 means unlimited.
+    }else if(token == "learn_approximate"){
+      ss >> token;
+      if(ss.fail() || !(token == "TRUE" || token == "FALSE")) goto error;
+      LEARN_APPROXIMATE = token == "TRUE";
     }else if(token == "return_window_name"){
       ss >> token;
       if(ss.fail()) goto error;
@@ -329,11 +819,11 @@ private:
     }else{
       goto error;
     }
-    return;
+    return true;
 
   error:
     LOG("Main_Parser " << this << " >> parse_global: Error at line \"" << line << "\"");
-    exit(1);
+    return false;
   }
 };
 
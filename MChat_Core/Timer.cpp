@@ -2,47 +2,113 @@
 #define _H_Timer
 
 #include <chrono>
+#include <climits>
+#include <algorithm>
 #include <windows.h>
 
 using namespace std;
 
 /**
- * Acts as the central control for all update operations.
+ * Interface for the source of the current time.
+ * Times are in milliseconds since the epoch.
  */
-class Timer{
-  time_t now_c;
-  int wait_time; // the time to wait between updates. in milliseconds. recommended to set it above 60000 (60 sec).
+class Clock{
+public:
+  virtual ~Clock(){}
+
+  /**
+   * Get the current time.
+   * long long return value: the current time in milliseconds since the epoch.
+   */
+  virtual long long now() = 0;
+
+  /**
+   * Waits until a time. Returns at once if the time has passed.
+   * long long time: the time to wake up at. in milliseconds since the epoch. LLONG_MAX to wait forever.
+   */
+  virtual void wait_until(long long time) = 0;
+};
+
+/**
+ * The real time. Waiting sleeps.
+ */
+class System_Clock : public Clock{
+public:
+  long long now(){
+    return chrono::duration_cast<chrono::milliseconds>(chrono::system_clock::now().time_since_epoch()).count();
+  }
+
+  void wait_until(long long time){
+    if(time == LLONG_MAX){
+      Sleep(INFINITE);
+      return;
+    }
+    long long wait_time;
+    while((wait_time = time - now()) > 0){
+      Sleep((DWORD) min(wait_time, (long long) INFINITE - 1));
+    }
+  }
+};
+
+/**
+ * A simulated time that only moves when it is waited on. Waiting returns at once,
+ * so a whole week of schedules can be run in seconds.
+ */
+class Virtual_Clock : public Clock{
+  long long m_now; // the simulated time.
 
 public:
   /**
    * Constructor
+   * long long start: the time to start at. in milliseconds since the epoch.
    */
-  Timer(int wait){
-    update();
-    wait_time = wait;
+  Virtual_Clock(long long start){
+    m_now = start;
+  }
+
+  long long now(){
+    return m_now;
   }
 
+  void wait_until(long long time){
+    m_now = max(m_now, time);
+  }
+};
+
+/**
+ * Acts as the central control for all update operations.
+ * Reads the time from a Clock, the real time unless another one is given.
+ */
+class Timer{
+  Clock *m_clock; // the source of the time.
+  System_Clock m_system_clock; // used when no clock is given.
+
+public:
   /**
-   * Get the tm for the current time.
-   * tm return value: the tm of the current time.
+   * Constructor
+   * Clock *clock: the source of the time. NULL for the real time. must outlive the Timer.
    */
-  tm *get_tm(){
-    update();
-    return localtime(&now_c);
+  Timer(Clock *clock = NULL){
+    m_clock = clock != NULL ? clock : &m_system_clock;
   }
 
+  Timer(const Timer&) = delete;
+  Timer &operator=(const Timer&) = delete;
+
   /**
-   * Waits until the next update cycle.
+   * Get the current time.
+   * long long return value: the current time in milliseconds since the epoch.
    */
-  void wait_next(){
-    Sleep(wait_time);
+  long long now(){
+    return (*m_clock).now();
   }
-private:
+
   /**
-   * Updates the time with the current time.
+   * Waits until a time. Returns at once if the time has passed.
+   * long long time: the time to wake up at. in milliseconds since the epoch. LLONG_MAX to wait forever.
    */
-  void update(){
-    now_c = chrono::system_clock::to_time_t(chrono::system_clock::now());
+  void wait_until(long long time){
+    (*m_clock).wait_until(time);
   }
 };
 
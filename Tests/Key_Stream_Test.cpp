@@ -0,0 +1,42 @@
+/**
+ * Checks the key events an MS_Window hands to its Key_Backend: shift around shifted characters,
+ * the Enter key for a line break, and unicode input, with surrogate pairs, for characters without a key.
+ * Builds on any platform:
+ *   g++ -std=c++17 -I MChat_Core/My_Library Tests/Key_Stream_Test.cpp -pthread -o key_stream_test
+ * Exits with 1 if an event is wrong.
+ */
+#include "Sender_Fixture.hpp"
+
+using namespace std;
+
+int main(){
+  Sender_Fixture fixture;
+  Recording_Backend &keys = fixture.keys;
+  MS_Window &sender = fixture.sender;
+
+  struct Case{ string text; string events; };
+  const Case cases[] = {
+    {"Ab", "a0+ 41+ 41- a0- 42+ 42-"}, // shift (0xA0) is held around the shifted key only.
+    {"!\n", "a0+ 31+ 31- a0- d+ d-"}, // a line break presses Enter (0x0D).
+    {"\xC3\xA9", "ue9+ ue9-"}, // U+00E9 has no key and is typed as unicode.
+    {"\xF0\x9F\x98\x80", "ud83d+ ud83d- ude00+ ude00-"}, // U+1F600 is typed as a UTF-16 surrogate pair.
+  };
+
+  bool ok = true;
+  for(const Case &c : cases){
+    keys.clear();
+    sender.queue_message(c.text);
+    if(!sender.send(0)){
+      cout << "the window was not found." << endl;
+      return 1;
+    }
+    string events = describe(keys.get_events());
+    if(events != c.events){
+      cout << "FAILED: expected \"" << c.events << "\", got \"" << events << "\"" << endl;
+      ok = false;
+    }
+  }
+
+  cout << (ok ? "OK" : "FAILED") << endl;
+  return ok ? 0 : 1;
+}
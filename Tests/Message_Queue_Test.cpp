@@ -0,0 +1,64 @@
+/**
+ * Runs 4 producer threads against 1 consumer on a small Message_Queue, for every overflow policy.
+ * Checks that the messages of every producer come out in the order they were pushed, that every message is either
+ * popped or reported as dropped, and that BLOCK drops nothing. With DROP_OLDEST one push() can drop several old messages
+ * when other producers fill the queue again meanwhile, so there the reported drops are only a lower bound.
+ * Builds on any platform. Meant to be run under ThreadSanitizer too:
+ *   g++ -std=c++17 -O1 -g -fsanitize=thread -I MChat_Core/My_Library Tests/Message_Queue_Test.cpp -pthread -o message_queue_test
+ * Exits with 1 if a check fails.
+ */
+#include <iostream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+
+#include "Message_Queue.cpp"
+
+using namespace std;
+
+int main(){
+  const int PRODUCERS = 4;
+  const int MESSAGES = 5000; // per producer.
+  const char *NAMES[] = {"drop_oldest", "drop_newest", "block"};
+  const Overflow_Policy POLICIES[] = {DROP_OLDEST, DROP_NEWEST, BLOCK};
+  bool ok = true;
+
+  for(int p = 0; p < 3; p++){
+    Message_Queue<string> queue(8, POLICIES[p]);
+    atomic<long long> dropped(0);
+    atomic<int> producing(PRODUCERS);
+    vector<thread> producers;
+    for(int id = 0; id < PRODUCERS; id++){
+      producers.push_back(thread([&, id]{
+        for(int i = 0; i < MESSAGES; i++){
+          if(!queue.push(to_string(id) + " " + to_string(i) + string(30, '.'))) dropped++; // long enough to be on the heap.
+        }
+        producing--;
+      }));
+    }
+
+    long long popped = 0;
+    bool ordered = true;
+    vector<int> last(PRODUCERS, -1);
+    string message;
+    while(producing > 0 || !queue.empty()){
+      if(!queue.pop(message)) continue;
+      popped++;
+      int id = message[0] - '0';
+      int i = stoi(message.substr(2));
+      if(i <= last[id]) ordered = false;
+      last[id] = i;
+    }
+    for(thread &producer : producers) producer.join();
+
+    long long total = (long long) PRODUCERS * MESSAGES;
+    bool counted = POLICIES[p] == DROP_OLDEST ? popped + dropped <= total : popped + dropped == total;
+    bool passed = ordered && counted && (POLICIES[p] != BLOCK || dropped == 0);
+    cout << NAMES[p] << ": " << popped << " popped, " << dropped << " dropped" << (ordered ? "" : ", out of order") << (passed ? "" : " FAILED") << endl;
+    ok = ok && passed;
+  }
+
+  cout << (ok ? "OK" : "FAILED") << endl;
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,51 @@
+/**
+ * Checks the paste mode of MS_Window: every line is put in the clipboard and pasted with Ctrl-V,
+ * and the line break is typed with Enter. A line that cannot be put in the clipboard is typed instead,
+ * without trying the clipboard again for the rest of it.
+ * Builds on any platform:
+ *   g++ -std=c++17 -I MChat_Core/My_Library Tests/Paste_Test.cpp -pthread -o paste_test
+ * Exits with 1 if a check fails.
+ */
+#include "Sender_Fixture.hpp"
+
+using namespace std;
+
+/**
+ * Sends a message and compares the events and the clipboard with the expected ones.
+ */
+bool check(MS_Window &sender, Recording_Backend &keys, Memory_Clipboard &clipboard, string message, string events, string text, size_t calls){
+  keys.clear();
+  size_t before = clipboard.get_calls();
+  sender.queue_message(message);
+  if(!sender.send(0)){
+    cout << "FAILED: the window was not found." << endl;
+    return false;
+  }
+  string got = describe(keys.get_events());
+  bool ok = got == events && clipboard.get_text() == text && clipboard.get_calls() - before == calls;
+  if(!ok){
+    cout << "FAILED: expected \"" << events << "\", \"" << text << "\" and " << calls << " set_text() calls, got \""
+         << got << "\", \"" << clipboard.get_text() << "\" and " << clipboard.get_calls() - before << "." << endl;
+  }
+  return ok;
+}
+
+int main(){
+  Memory_Clipboard clipboard;
+  Sender_Fixture fixture(&clipboard);
+  Recording_Backend &keys = fixture.keys;
+  MS_Window &sender = fixture.sender;
+
+  const string PASTE = "11+ 56+ 56- 11-"; // Ctrl-V.
+  const string ENTER = "d+ d-";
+  bool ok = true;
+  ok = check(sender, keys, clipboard, "hello\n", PASTE + " " + ENTER, "hello", 1) && ok;
+  ok = check(sender, keys, clipboard, "hi\nyou\n", PASTE + " " + ENTER + " " + PASTE + " " + ENTER, "you", 2) && ok;
+  ok = check(sender, keys, clipboard, "last", PASTE, "last", 1) && ok; // no line break, no Enter.
+
+  clipboard.set_available(false); // another program holds the clipboard.
+  ok = check(sender, keys, clipboard, "abc\nd\n", "41+ 41- 42+ 42- 43+ 43- " + ENTER + " 44+ 44- " + ENTER, "last", 2) && ok;
+
+  cout << (ok ? "OK" : "FAILED") << endl;
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,37 @@
+/**
+ * Checks that a message longer than the character rate allows at once costs a bounded number of window activations.
+ * The bucket holds a minute's worth of characters, so the message is sent in two parts: a full bucket, and the rest
+ * once the bucket has refilled enough for it. It must not go out a few characters per round as the bucket refills.
+ * Builds on any platform:
+ *   g++ -std=c++17 -O2 -I MChat_Core/My_Library Tests/Rate_Limit_Test.cpp -pthread -o rate_limit_test
+ * Takes about a tenth of a second. Exits with 1 if a check fails.
+ */
+#include "Sender_Fixture.hpp"
+
+using namespace std;
+
+int main(){
+  const int RATE = 60000; // characters per minute, one per millisecond.
+  const int EXTRA = 100; // the characters that do not fit in a full bucket.
+  Send_Limits limits;
+  limits.characters_per_minute = RATE;
+  Sender_Fixture fixture(NULL, limits);
+  Fake_Window_Manager &manager = fixture.manager;
+  Recording_Backend &keys = fixture.keys;
+  MS_Window &sender = fixture.sender;
+
+  sender.queue_message(string(RATE + EXTRA, 'a'));
+  int rounds = 0;
+  while(!sender.is_empty() && rounds < 1000){ // as the Send_Worker does: wait, then send.
+    long long wait = sender.get_wait();
+    if(wait > 0) this_thread::sleep_for(chrono::milliseconds(wait));
+    sender.send(0);
+    rounds++;
+  }
+
+  size_t typed = keys.get_events().size() / 2; // a press and a release per character.
+  cout << "rounds: " << rounds << ", activations: " << manager.get_activate_calls() << ", characters: " << typed << endl;
+  bool ok = sender.is_empty() && typed == (size_t) RATE + EXTRA && rounds <= 3 && manager.get_activate_calls() <= 2 * (size_t) rounds;
+  cout << (ok ? "OK" : "FAILED") << endl;
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,116 @@
+/**
+ * Queues messages on the main thread for a Send_Worker with two senders that fail every third send and then wait
+ * a few milliseconds before they try again, while the main thread polls the reports.
+ * Checks that every message is sent once and in order, and that there is a report for every send, failed or not.
+ * Builds on any platform. Meant to be run under ThreadSanitizer too:
+ *   g++ -std=c++17 -O1 -g -fsanitize=thread -I MChat_Core/My_Library Tests/Send_Worker_Test.cpp -pthread -o send_worker_test
+ * Exits with 1 if a check fails.
+ */
+#include <iostream>
+#include <string>
+#include <list>
+#include <atomic>
+#include <thread>
+#include <chrono>
+
+#include "Send_Worker.cpp"
+
+using namespace std;
+
+static long long now(){
+  return chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * A Message_Sender that fails every third send and then waits RETRY milliseconds, like a window that was not found.
+ */
+class Flaky_Sender : public Message_Sender {
+  static const int RETRY = 3;
+  Message_Queue<string> m_queue;
+  atomic<long long> m_retry; // when it may send again. in milliseconds.
+  atomic<int> m_sends;
+  atomic<int> m_failures;
+  atomic<int> m_sent; // messages sent.
+  atomic<bool> m_ordered;
+
+public:
+  Flaky_Sender() : m_queue(16, BLOCK), m_retry(0), m_sends(0), m_failures(0), m_sent(0), m_ordered(true){}
+
+  void queue_message(string s){
+    m_queue.push(move(s));
+  }
+
+  bool send(int /*budget*/){
+    if(++m_sends % 3 == 0){
+      m_failures++;
+      m_retry = now() + RETRY;
+      return false;
+    }
+    string message;
+    while(m_queue.pop(message)){
+      if(stoi(message) != m_sent) m_ordered = false;
+      m_sent++;
+    }
+    return true;
+  }
+
+  bool is_empty(){
+    return m_queue.empty();
+  }
+
+  long long get_wait(){
+    if(is_empty()) return NO_DEADLINE;
+    return max(m_retry - now(), 0LL);
+  }
+
+  bool is_saturated(){
+    return false;
+  }
+
+  int get_sends() const { return m_sends; }
+  int get_failures() const { return m_failures; }
+  int get_sent() const { return m_sent; }
+  bool is_ordered() const { return m_ordered; }
+};
+
+int main(){
+  const int MESSAGES = 300;
+  Flaky_Sender senders[2];
+  int sent_reports[2] = {0, 0};
+  int failed_reports[2] = {0, 0};
+  auto count = [&](const Send_Report &report){
+    int i = report.sender == &senders[0] ? 0 : 1;
+    (report.sent ? sent_reports : failed_reports)[i]++;
+  };
+
+  Send_Report report;
+  {
+    Send_Worker worker(list<Message_Sender*>{&senders[0], &senders[1]});
+    for(int i = 0; i < MESSAGES; i++){
+      senders[i % 2].queue_message(to_string(i / 2));
+      worker.notify();
+      while(worker.poll_report(report)) count(report);
+      if(i % 10 == 0) this_thread::sleep_for(chrono::milliseconds(1));
+    }
+    auto reported = [&](int i){ return sent_reports[i] + failed_reports[i] == senders[i].get_sends(); };
+    long long deadline = now() + 5000; // wait for the last retries and their reports.
+    while(!(senders[0].is_empty() && senders[1].is_empty() && reported(0) && reported(1)) && now() < deadline){
+      while(worker.poll_report(report)) count(report);
+      this_thread::sleep_for(chrono::milliseconds(1));
+    }
+  }
+
+  bool ok = true;
+  for(int i = 0; i < 2; i++){
+    Flaky_Sender &sender = senders[i];
+    bool passed = sender.get_sent() == MESSAGES / 2 && sender.is_ordered() && sender.get_failures() > 0
+                  && sent_reports[i] == sender.get_sends() - sender.get_failures() && failed_reports[i] == sender.get_failures();
+    cout << "sender " << i << ": " << sender.get_sent() << " messages sent, " << sender.get_sends() << " sends, "
+         << sender.get_failures() << " failed, " << sent_reports[i] + failed_reports[i] << " reports"
+         << (sender.is_ordered() ? "" : ", out of order") << (passed ? "" : " FAILED") << endl;
+    ok = ok && passed;
+  }
+
+  cout << (ok ? "OK" : "FAILED") << endl;
+  return ok ? 0 : 1;
+}
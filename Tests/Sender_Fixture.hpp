@@ -0,0 +1,46 @@
+#ifndef _H_SENDER_FIXTURE
+#define _H_SENDER_FIXTURE
+
+#include <iostream>
+#include <sstream>
+
+#include "Message_Sender.cpp"
+
+using namespace std;
+
+/**
+ * Writes events as "code+" for a press and "code-" for a release, with a "u" before the code of unicode input.
+ * The codes are in hex.
+ */
+string describe(const vector<Key_Event> &events){
+  stringstream ss;
+  for(size_t i = 0; i < events.size(); i++){
+    if(i > 0) ss << " ";
+    ss << (events[i].unicode ? "u" : "") << hex << events[i].code << (events[i].up ? "-" : "+");
+  }
+  return ss.str();
+}
+
+/**
+ * An MS_Window that sends to the made-up window "Target" and returns to "MChat", with its keys recorded.
+ * Nothing is paused between keys.
+ */
+struct Sender_Fixture{
+  Fake_Window_Manager manager;
+  Window_Registry registry;
+  Recording_Backend keys;
+  MS_Window sender;
+
+  /**
+   * Constructor
+   * Clipboard *clipboard: pastes the messages. NULL to type them.
+   * Send_Limits limits: how fast to send.
+   */
+  Sender_Fixture(Clipboard *clipboard = NULL, Send_Limits limits = Send_Limits())
+    : registry(&manager), sender(0, 8, "Target", "MChat", 8, DROP_NEWEST, &keys, clipboard, &registry, limits){
+    manager.open_window("Target");
+    manager.open_window("MChat");
+  }
+};
+
+#endif
@@ -0,0 +1,43 @@
+/**
+ * Times Window_Registry against 32 made-up windows and counts the calls it makes to the window manager.
+ * A round activates a target window and then the home window, as a send does.
+ * Builds on any platform:
+ *   g++ -std=c++17 -O2 -I MChat_Core/My_Library Tests/Window_Registry_Bench.cpp -o window_registry_bench
+ * Exits with 1 if the windows are listed more often than once per name and once per window that went away.
+ */
+#include <iostream>
+#include <chrono>
+
+#include "Window_Registry.cpp"
+
+using namespace std;
+
+int main(){
+  const int ROUNDS = 1000;
+  Fake_Window_Manager manager;
+  Window_Registry registry(&manager);
+  for(int i = 0; i < 30; i++) manager.open_window("Other " + to_string(i));
+  Window_Handle target = manager.open_window("Google Chrome");
+  manager.open_window("MChat.exe");
+
+  auto start = chrono::steady_clock::now();
+  for(int i = 0; i < ROUNDS; i++){
+    if(!registry.activate("Google") || !registry.activate("MChat")){
+      cout << "round " << i << ": a window was not found." << endl;
+      return 1;
+    }
+  }
+  double time = chrono::duration<double, micro>(chrono::steady_clock::now() - start).count();
+  cout << ROUNDS << " rounds: " << time / ROUNDS << " us per round, " << manager.get_list_calls() << " listings, "
+       << (double) manager.get_activate_calls() / ROUNDS << " activations per round." << endl;
+  bool ok = manager.get_list_calls() == 2 && manager.get_activate_calls() == 2 * ROUNDS;
+
+  manager.close_window(target); // the cached handle goes stale.
+  manager.open_window("Google Chrome");
+  ok = ok && registry.activate("Google") && manager.get_list_calls() == 3;
+  ok = ok && !registry.activate("Notepad") && manager.get_list_calls() == 4;
+  cout << "after a window went away and a missing one was asked for: " << manager.get_list_calls() << " listings." << endl;
+
+  cout << (ok ? "OK" : "FAILED") << endl;
+  return ok ? 0 : 1;
+}